@@ -0,0 +1,35 @@
+#ifndef _ACCUMULATOR_H
+#define _ACCUMULATOR_H
+
+// running sum of products for the matrix kernels, starting from a given value. The modular fields specialize it to
+// keep the products unreduced and reduce once in value(); by default each product is added with addmul
+template<class Field>
+class Accumulator
+{
+    Field sum;
+
+public:
+    // whether the sums are kept unreduced; gauss only pays for accumulators in its rows when they are
+    static const bool LAZY = false;
+
+    Accumulator(): sum() {}
+
+    explicit Accumulator(const Field &a): sum(a) {}
+
+    void add(const Field &x, const Field &y)
+    {
+        addmul(sum, x, y);
+    }
+
+    void sub(const Field &x, const Field &y)
+    {
+        submul(sum, x, y);
+    }
+
+    const Field value() const
+    {
+        return sum;
+    }
+};
+
+#endif
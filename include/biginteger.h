@@ -6,6 +6,7 @@
 #include <string>
 #include <stdexcept>
 #include <sstream>
+#include "limbvector.h"
 
 enum compare_t
 {
@@ -34,27 +35,119 @@ inline const std::string toString(const T &a)
 class BigInteger
 {
 private:
-    std::vector<unsigned> digits;
+    LimbVector digits;
     bool negative;
 
     void normalize() noexcept;
 
-    void shiftRight(size_t a) noexcept;
-
     void multiply(unsigned a) noexcept;
 
+    void _add_abs(unsigned a) noexcept;
+
+    void _add_shifted(const BigInteger &a, size_t shift) noexcept;
+
+    const BigInteger _slice(size_t from, size_t len) const noexcept;
+
+    void _shift_left(size_t bits) noexcept;
+
+    void _shift_right(size_t bits) noexcept;
+
+    static void _mul_basecase(unsigned *res, const unsigned *a, size_t na, const unsigned *b, size_t nb) noexcept;
+
+    static void _sqr_basecase(unsigned *res, const unsigned *a, size_t n) noexcept;
+
+    static unsigned _add_limbs(unsigned *res, const unsigned *a, size_t na, const unsigned *b, size_t nb) noexcept;
+
+    static unsigned _sub_limbs(unsigned *res, const unsigned *a, size_t na, const unsigned *b, size_t nb) noexcept;
+
+    static unsigned _addmul_limb(unsigned *res, const unsigned *a, size_t n, unsigned m) noexcept;
+
+    static unsigned _submul_limb(unsigned *res, const unsigned *a, size_t n, unsigned m) noexcept;
+
+    static void _shift_left_limbs(unsigned *a, size_t n, unsigned shift) noexcept;
+
+    static void _shift_right_limbs(unsigned *a, size_t n, unsigned shift) noexcept;
+
+    static compare_t _compare_limbs(const unsigned *a, const unsigned *b, size_t n) noexcept;
+
+    static bool _diff_limbs(unsigned *res, const unsigned *a, size_t na, const unsigned *b, size_t nb) noexcept;
+
+    static size_t _karatsuba_scratch(size_t n) noexcept;
+
+    static void _karatsuba(unsigned *res, const unsigned *a, const unsigned *b, size_t n, unsigned *scratch) noexcept;
+
+    static void _karatsuba_sqr(unsigned *res, const unsigned *a, size_t n, unsigned *scratch) noexcept;
+
+    const BigInteger _multiply(const BigInteger &a) const noexcept;
+
+    const BigInteger unbalanced(const BigInteger &a) const noexcept;
+
     const BigInteger karatsuba(const BigInteger &a) const noexcept;
 
+    const BigInteger toom3(const BigInteger &a) const noexcept;
+
+    const BigInteger toom4(const BigInteger &a) const noexcept;
+
+    const BigInteger ntt(const BigInteger &a) const noexcept;
+
+    static void _multiply_pointwise(const BigInteger *x, const BigInteger *y, BigInteger *r, size_t n, bool sqr) noexcept;
+
     compare_t _compareAbs(const BigInteger &a) const noexcept;
 
-    void _divide(int a, int &remainder);
+    unsigned _divide(unsigned a) noexcept;
+
+    const BigInteger _divide_long(const BigInteger &a) noexcept;
+
+    const BigInteger _divide_bz(const BigInteger &a) noexcept;
+
+    const BigInteger _div2n1n(const BigInteger &b, size_t n) noexcept;
+
+    const BigInteger _div3n2n(const BigInteger &a3, const BigInteger &b, const BigInteger &b1, const BigInteger &b2,
+                              size_t n) noexcept;
+
+    static const BigInteger &_decimal_power(size_t k);
+
+    static const BigInteger _parse_decimal(const char *s, size_t n);
+
+    void _write_decimal(std::string &out, size_t k, bool pad) const;
+
+    size_t _bit_length() const noexcept;
+
+    unsigned long long _bits(size_t from) const noexcept;
 
-    const BigInteger _divide_long(BigInteger a) noexcept;
+    const BigInteger _low_bits(size_t bits) const noexcept;
+
+    static const BigInteger _from_word(unsigned long long a) noexcept;
+
+    static const BigInteger _mul_add(const BigInteger &x, unsigned mx, const BigInteger &y, unsigned my) noexcept;
+
+    static const BigInteger _mul_sub(const BigInteger &x, unsigned mx, const BigInteger &y, unsigned my) noexcept;
+
+    static void _mul_matrix(BigInteger *m, const BigInteger *r) noexcept;
+
+    static bool _gcd_step(BigInteger &a, BigInteger &b, BigInteger *m, size_t s) noexcept;
+
+    static void _hgcd(BigInteger &a, BigInteger &b, BigInteger *m) noexcept;
+
+    static void _hgcd_reduce(BigInteger &a, BigInteger &b, BigInteger *m, size_t p) noexcept;
+
+    void _addmul(const BigInteger &x, const BigInteger &y, bool subtract) noexcept;
+
+    friend void addmul(BigInteger &acc, const BigInteger &x, const BigInteger &y) noexcept;
+
+    friend void submul(BigInteger &acc, const BigInteger &x, const BigInteger &y) noexcept;
+
+    friend const BigInteger gcd(BigInteger a, BigInteger b) noexcept;
+
+    friend std::pair<BigInteger, BigInteger> ext_gcd(BigInteger a, BigInteger b);
+
+    friend class MontgomeryContext;
 
 public:
 
-    static const unsigned BLOCK_MOD = 1000000000;
-    static const size_t BLOCK_SIZE = 9;
+    static const unsigned LIMB_BITS = 32;
+    static const unsigned DECIMAL_MOD = 1000000000;
+    static const size_t DECIMAL_SIZE = 9;
 
     BigInteger() noexcept: digits(), negative(false) {};
 
@@ -71,7 +164,13 @@ public:
 
     explicit operator int() const noexcept
     {
-        return digits.empty() ? 0 : (digits[0] * (negative ? -1 : 1));
+        return digits.empty() ? 0 : (int(digits[0]) * (negative ? -1 : 1));
+    }
+
+    explicit operator long long() const noexcept
+    {
+        unsigned long long a = _bits(0);
+        return static_cast<long long>(negative ? 0 - a : a);
     }
 
     std::string toString() const noexcept;
@@ -90,7 +189,9 @@ public:
 
     BigInteger &operator+=(const BigInteger &a) noexcept;
 
-    BigInteger &operator*=(BigInteger a) noexcept;
+    BigInteger &operator*=(const BigInteger &a) noexcept;
+
+    const BigInteger square() const noexcept;
 
     BigInteger &operator/=(const BigInteger &a);
 
@@ -134,6 +235,10 @@ public:
     }
 
     void _divide_by_2() noexcept;
+
+    const BigInteger _divmod(const BigInteger &a);
+
+    void _divexact(const BigInteger &a);
 };
 
 
@@ -187,8 +292,42 @@ inline const BigInteger abs(const BigInteger &a) noexcept
 }
 
 
+std::pair<BigInteger, BigInteger> divmod(const BigInteger &a, const BigInteger &b);
+
+// a / b for b dividing a, cheaper than operator/
+const BigInteger divexact(const BigInteger &a, const BigInteger &b);
+
+// acc += x * y and acc -= x * y
+void addmul(BigInteger &acc, const BigInteger &x, const BigInteger &y) noexcept;
+
+void submul(BigInteger &acc, const BigInteger &x, const BigInteger &y) noexcept;
+
 const BigInteger gcd(BigInteger a, BigInteger b) noexcept;
 
 std::pair<BigInteger, BigInteger> ext_gcd(BigInteger a, BigInteger b);
 
+
+// residues modulo m in Montgomery form a * R mod m, R = 2^(32n) for an n-limb m, so that a product is reduced with
+// n multiply-adds instead of a division; an even m has no such form, and then the residues stay plain
+class MontgomeryContext
+{
+    BigInteger mod, r2;
+    unsigned inv;
+
+public:
+    explicit MontgomeryContext(const BigInteger &m);
+
+    // a * R mod m for 0 <= a < m
+    const BigInteger toForm(const BigInteger &a) const;
+
+    // a * R^-1 mod m for 0 <= a < m
+    const BigInteger fromForm(const BigInteger &a) const;
+
+    // a * R^-1 mod m for 0 <= a < m * R, the product of two residues in the form stays in the form
+    void reduce(BigInteger &a) const;
+
+    // inverse of a residue in the form, in the form
+    const BigInteger inverse(const BigInteger &a) const;
+};
+
 #endif
@@ -0,0 +1,143 @@
+#ifndef _BIT_H
+#define _BIT_H
+
+#include <iostream>
+#include "biginteger.h"
+
+// element of the field of order 2; main() picks it for order 2, and Matrix<Bit> stores 64 of them in a word
+class Bit
+{
+    bool val;
+
+public:
+
+    Bit(const BigInteger &n): val(n.odd()) {}
+
+    Bit(int n) noexcept: val(n & 1) {}
+
+    Bit() noexcept: val(false) {};
+
+    explicit operator const BigInteger() const noexcept
+    {
+        return BigInteger(int(val));
+    }
+
+    explicit operator int() const noexcept
+    {
+        return val;
+    }
+
+    explicit operator bool() const noexcept
+    {
+        return val;
+    }
+
+    const Bit operator-() const noexcept
+    {
+        return *this;
+    }
+
+    const Bit operator+() const noexcept
+    {
+        return *this;
+    }
+
+    Bit &operator+=(const Bit &a) noexcept
+    {
+        val ^= a.val;
+        return *this;
+    }
+
+    const Bit operator+(const Bit &a) const noexcept
+    {
+        Bit temp(*this);
+        return temp += a;
+    }
+
+    Bit &operator-=(const Bit &a) noexcept
+    {
+        val ^= a.val;
+        return *this;
+    }
+
+    const Bit operator-(const Bit &a) const noexcept
+    {
+        Bit temp(*this);
+        return temp -= a;
+    }
+
+    Bit &operator*=(const Bit &a) noexcept
+    {
+        val &= a.val;
+        return *this;
+    }
+
+    const Bit operator*(const Bit &a) const noexcept
+    {
+        Bit temp(*this);
+        return temp *= a;
+    }
+
+    friend void addmul(Bit &acc, const Bit &x, const Bit &y) noexcept
+    {
+        acc.val ^= x.val & y.val;
+    }
+
+    friend void submul(Bit &acc, const Bit &x, const Bit &y) noexcept
+    {
+        acc.val ^= x.val & y.val;
+    }
+
+    const Bit inverse() const
+    {
+        if(!val)
+            throw zero_division_error("Trying to invert zero");
+        return *this;
+    }
+
+    Bit operator/=(const Bit &a)
+    {
+        return *this *= a.inverse();
+    }
+
+    const Bit operator/(const Bit &a) const
+    {
+        return *this * a.inverse();
+    }
+
+    bool operator<(const Bit &) const
+    {
+        throw invalid_number_error("Elements of a finite field are not ordered");
+    }
+
+    bool operator>(const Bit &) const
+    {
+        throw invalid_number_error("Elements of a finite field are not ordered");
+    }
+
+    friend bool operator==(const Bit &a, const Bit &b) noexcept
+    {
+        return a.val == b.val;
+    }
+
+    friend bool operator!=(const Bit &a, const Bit &b) noexcept
+    {
+        return a.val != b.val;
+    }
+
+};
+
+inline std::ostream &operator<<(std::ostream &out, const Bit &a)
+{
+    return out << int(a);
+}
+
+inline std::istream &operator>>(std::istream &in, Bit &a)
+{
+    BigInteger t;
+    in >> t;
+    a = t;
+    return in;
+}
+
+#endif
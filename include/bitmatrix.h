@@ -0,0 +1,313 @@
+#ifndef _BITMATRIX_H
+#define _BITMATRIX_H
+
+#include "matrix.h"
+#include "bit.h"
+
+// matrix over the field of order 2 with each row packed into 64-bit words, column j at bit j % 64 of word j / 64.
+// Additions are XORs of whole words, multiplication and elimination use the Method of Four Russians. The bits past the
+// last column are kept zero
+template<>
+class Matrix<Bit>
+{
+    typedef unsigned long long word;
+
+    unsigned M, N, W;
+
+    class BitRef
+    {
+        word *w;
+        word mask;
+    public:
+        BitRef(word *pos, unsigned bit): w(pos), mask(1ull << bit) {};
+
+        BitRef &operator=(const Bit &a)
+        {
+            *w = (a ? *w | mask : *w & ~mask);
+            return *this;
+        }
+
+        BitRef &operator=(const BitRef &a)
+        {
+            return *this = Bit(a);
+        }
+
+        BitRef &operator+=(const Bit &a)
+        {
+            if(a)
+                *w ^= mask;
+            return *this;
+        }
+
+        BitRef &operator-=(const Bit &a)
+        {
+            return *this += a;
+        }
+
+        BitRef &operator*=(const Bit &a)
+        {
+            if(!a)
+                *w &= ~mask;
+            return *this;
+        }
+
+        operator Bit() const
+        {
+            return Bit(int((*w & mask) != 0));
+        }
+
+        explicit operator const BigInteger() const
+        {
+            return BigInteger(int((*w & mask) != 0));
+        }
+
+        explicit operator int() const
+        {
+            return (*w & mask) != 0;
+        }
+
+        explicit operator bool() const
+        {
+            return (*w & mask) != 0;
+        }
+
+        friend const Bit operator+(const BitRef &a, const Bit &b)
+        {
+            return Bit(a) + b;
+        }
+
+        friend const Bit operator-(const BitRef &a, const Bit &b)
+        {
+            return Bit(a) - b;
+        }
+
+        friend const Bit operator*(const BitRef &a, const Bit &b)
+        {
+            return Bit(a) * b;
+        }
+
+        friend const Bit operator/(const BitRef &a, const Bit &b)
+        {
+            return Bit(a) / b;
+        }
+
+        friend bool operator==(const BitRef &a, const Bit &b)
+        {
+            return Bit(a) == b;
+        }
+
+        friend bool operator!=(const BitRef &a, const Bit &b)
+        {
+            return Bit(a) != b;
+        }
+
+        friend void addmul(BitRef acc, const Bit &x, const Bit &y)
+        {
+            acc += x * y;
+        }
+
+        friend void submul(BitRef acc, const Bit &x, const Bit &y)
+        {
+            acc -= x * y;
+        }
+    };
+
+    class MatrixRow
+    {
+        word *arr;
+    public:
+        MatrixRow(word *row): arr(row) {};
+
+        inline BitRef operator[](unsigned c)
+        {
+            return BitRef(arr + c / 64, c % 64);
+        }
+    };
+
+    class ConstMatrixRow
+    {
+        const word *arr;
+    public:
+        ConstMatrixRow(const word *row): arr(row) {};
+
+        inline const Bit operator[](unsigned c)
+        {
+            return Bit(int(arr[c / 64] >> c % 64 & 1));
+        }
+    };
+
+    word *arr;
+    typedef MatrixRow row_t;
+    typedef ConstMatrixRow crow_t;
+
+    inline word *_row(unsigned r) const
+    {
+        return arr + size_t(r) * W;
+    }
+
+    static unsigned _eliminate(word *a, unsigned rows, unsigned width, unsigned cols, bool reduced,
+                               std::vector<unsigned> *pivots);
+
+    static void _copyBits(word *dst, unsigned to, const word *src, unsigned from, unsigned count);
+
+    unsigned _joinedGauss(Matrix &ext, bool reduced, std::vector<unsigned> *pivots);
+
+public:
+    Matrix(): M(0), N(0), W(0), arr(nullptr) {};
+
+    Matrix(unsigned height, unsigned width): M(height), N(width), W((width + 63) / 64),
+                                             arr(new word[size_t(height) * W]())
+    {};
+
+    Matrix(unsigned size): Matrix(size, size) {};
+
+    Matrix(const Matrix &a);
+
+    static const Matrix fromRow(const std::string &s);
+
+    Matrix &operator=(const Matrix &a);
+
+    ~Matrix()
+    {
+        delete[] arr;
+    }
+
+    unsigned gauss(Matrix *ext = nullptr);
+
+    static const Matrix identity(unsigned n);
+
+    inline static const Matrix fromNumber(Bit f)
+    {
+        Matrix a(1, 1);
+        a[0][0] = f;
+        return a;
+    }
+
+    inline row_t operator[](unsigned r)
+    {
+        return row_t(_row(r));
+    }
+
+    inline crow_t operator[](unsigned r) const
+    {
+        return crow_t(_row(r));
+    }
+
+    Matrix &operator+=(const Matrix &a);
+
+    inline const Matrix operator+(const Matrix &a) const
+    {
+        Matrix temp(*this);
+        return temp += a;
+    }
+
+    inline const Matrix operator-() const
+    {
+        return *this;
+    }
+
+    inline const Matrix operator+() const
+    {
+        return *this;
+    }
+
+    inline Matrix &operator-=(const Matrix &a)
+    {
+        return *this += a;
+    }
+
+    inline const Matrix operator-(const Matrix &a) const
+    {
+        Matrix temp(*this);
+        return temp -= a;
+    }
+
+    Matrix &operator*=(Bit a);
+
+    inline const Matrix operator*(Bit a) const
+    {
+        Matrix temp(*this);
+        return temp *= a;
+    }
+
+    inline Matrix &operator/=(Bit a)
+    {
+        return operator*=(Bit(1) / a);
+    }
+
+    inline const Matrix operator/(Bit a) const
+    {
+        Matrix temp(*this);
+        return temp /= a;
+    }
+
+    inline Matrix &operator*=(const Matrix &a)
+    {
+        return *this = *this * a;
+    }
+
+    const Matrix operator*(const Matrix &a) const;
+
+    const Bit det() const;
+
+    const Matrix transposed() const;
+
+    const Bit trace() const;
+
+    const Matrix inverted() const;
+
+    inline unsigned rank() const
+    {
+        Matrix tmp(*this);
+        return tmp.gauss();
+    }
+
+    bool operator==(const Matrix &a) const;
+
+    inline bool operator!=(const Matrix &a) const
+    {
+        return !(*this == a);
+    }
+
+    inline unsigned height() const
+    {
+        return M;
+    }
+
+    inline unsigned width() const
+    {
+        return N;
+    }
+
+    const Matrix submatrix(unsigned x1, unsigned y1, unsigned x2, unsigned y2) const;
+
+    void inverseExt(Matrix &ext);
+
+    const Matrix fundamental() const;
+
+    const Matrix partial() const;
+
+    const Matrix power(const BigInteger &pow) const;
+
+    const Matrix joinHorizontal(const Matrix &a) const;
+
+    const Matrix joinVertical(const Matrix &a) const;
+
+    const Matrix charPolynom() const;
+
+    const Matrix intDiagonal() const;
+
+    void swap(Matrix &a)
+    {
+        std::swap(arr, a.arr);
+        std::swap(M, a.M);
+        std::swap(N, a.N);
+        std::swap(W, a.W);
+    }
+
+    void _write_to_ostream(std::ostream &out) const;
+
+    void _read_from_istream(std::istream &in);
+};
+
+#endif
@@ -82,10 +82,14 @@ public:
         return int(_re);
     }
 
+    friend void addmul(Complex &acc, const Complex &x, const Complex &y);
+
+    friend void submul(Complex &acc, const Complex &x, const Complex &y);
+
     const BigInteger denominator() const
     {
         BigInteger a(_re.denominator()), b(_im.denominator());
-        return a * b / gcd(a, b);
+        return divexact(a, gcd(a, b)) * b;
     }
 };
 
@@ -111,4 +115,9 @@ std::ostream &operator<<(std::ostream &out, const Complex &a);
 
 std::istream &operator>>(std::istream &in, Complex &a);
 
+// acc += x * y and acc -= x * y
+void addmul(Complex &acc, const Complex &x, const Complex &y);
+
+void submul(Complex &acc, const Complex &x, const Complex &y);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,21 @@
+#ifndef _DISPATCH_H
+#define _DISPATCH_H
+
+// the SIMD kernels are compiled with target attributes next to portable ones, and a table of them is chosen for the
+// running CPU
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DISPATCH_X86
+#include <immintrin.h>
+#endif
+
+// the table select() builds, made on the first call; C++11 makes that thread-safe, and it works from static
+// initializers of other files as well
+template<class Kernels, Kernels (*select)()>
+inline const Kernels &dispatched() noexcept
+{
+    static const Kernels kernels = select();
+    return kernels;
+}
+
+#endif
@@ -3,35 +3,44 @@
 
 #include <iostream>
 #include "biginteger.h"
+#include "accumulator.h"
 
 extern BigInteger _FINITE_ORDER;
 
+// set up in main() together with _FINITE_ORDER; val is kept in its form
+extern MontgomeryContext _FINITE_CONTEXT;
+
 class Finite
 {
     BigInteger val;
 
+    friend class Accumulator<Finite>;
+
 public:
 
     Finite(const BigInteger &n): val(n)
     {
-        if(val >= _FINITE_ORDER)
+        if(val < 0 || val >= _FINITE_ORDER)
+        {
             val %= _FINITE_ORDER;
-        if(val < 0)
-            val = _FINITE_ORDER - ((0ll - val - 1) % _FINITE_ORDER + 1);
+            if(val < 0)
+                val += _FINITE_ORDER;
+        }
+        val = _FINITE_CONTEXT.toForm(val);
     }
 
     Finite(int n) noexcept: Finite(BigInteger(n)) {}
 
     Finite() noexcept: val(0) {};
 
-    explicit operator const BigInteger() const noexcept
+    explicit operator const BigInteger() const
     {
-        return val;
+        return _FINITE_CONTEXT.fromForm(val);
     }
 
-    explicit operator int() const noexcept
+    explicit operator int() const
     {
-        return int(val);
+        return int(_FINITE_CONTEXT.fromForm(val));
     }
 
     explicit operator bool() const noexcept
@@ -85,12 +94,8 @@ public:
 
     Finite &operator*=(const Finite &a)
     {
-        BigInteger nval = val * a.val;
-        if(nval >= _FINITE_ORDER)
-        {
-            nval %= _FINITE_ORDER;
-        }
-        val = nval;
+        val *= a.val;
+        _FINITE_CONTEXT.reduce(val);
         return *this;
     }
 
@@ -100,12 +105,35 @@ public:
         return temp *= a;
     }
 
+    friend void addmul(Finite &acc, const Finite &x, const Finite &y)
+    {
+        if(!x.val || !y.val)
+            return;
+        BigInteger t = x.val * y.val;
+        _FINITE_CONTEXT.reduce(t);
+        acc.val += t;
+        if(acc.val >= _FINITE_ORDER)
+            acc.val -= _FINITE_ORDER;
+    }
+
+    friend void submul(Finite &acc, const Finite &x, const Finite &y)
+    {
+        if(!x.val || !y.val)
+            return;
+        BigInteger t = x.val * y.val;
+        _FINITE_CONTEXT.reduce(t);
+        acc.val -= t;
+        if(acc.val < 0)
+            acc.val += _FINITE_ORDER;
+    }
+
     const Finite inverse() const
     {
         if(!val)
             throw zero_division_error("Trying to invert zero");
-        auto p = ext_gcd(val, _FINITE_ORDER);
-        return Finite(p.first);
+        Finite res;
+        res.val = _FINITE_CONTEXT.inverse(val);
+        return res;
     }
 
     Finite operator/=(const Finite &a)
@@ -128,18 +156,60 @@ public:
         assert(false);
     }
 
+    // the form is a bijection, so residues compare without leaving it
+    friend bool operator==(const Finite &a, const Finite &b) noexcept
+    {
+        return a.val == b.val;
+    }
+
+    friend bool operator!=(const Finite &a, const Finite &b) noexcept
+    {
+        return a.val != b.val;
+    }
+
 };
 
 
-inline bool operator==(const Finite &a, const Finite &b) noexcept
+// the products of the forms are summed as plain integers and brought back into the form once, so a dot product
+// costs one division and one reduction instead of a reduction per term
+template<>
+class Accumulator<Finite>
 {
-    return BigInteger(a) == BigInteger(b);
-}
+    Finite base;
+    BigInteger sum;
 
-inline bool operator!=(const Finite &a, const Finite &b) noexcept
-{
-    return BigInteger(a) != BigInteger(b);
-}
+public:
+    static const bool LAZY = true;
+
+    Accumulator(): base(), sum() {}
+
+    explicit Accumulator(const Finite &a): base(a), sum() {}
+
+    void add(const Finite &x, const Finite &y)
+    {
+        addmul(sum, x.val, y.val);
+    }
+
+    void sub(const Finite &x, const Finite &y)
+    {
+        submul(sum, x.val, y.val);
+    }
+
+    const Finite value() const
+    {
+        Finite res(base);
+        if(!sum)
+            return res;
+        BigInteger t = sum % _FINITE_ORDER;
+        if(t < 0)
+            t += _FINITE_ORDER;
+        _FINITE_CONTEXT.reduce(t);
+        res.val += t;
+        if(res.val >= _FINITE_ORDER)
+            res.val -= _FINITE_ORDER;
+        return res;
+    }
+};
 
 inline std::ostream &operator<<(std::ostream &out, const Finite &a)
 {
@@ -0,0 +1,266 @@
+#ifndef _FIXEDFINITE_H
+#define _FIXEDFINITE_H
+
+#include <iostream>
+#include <type_traits>
+#include "biginteger.h"
+#include "accumulator.h"
+#include "wordfinite.h"
+
+// residues modulo an order known at compile time, kept plain. A Mersenne order 2^k - 1 folds the high bits of a product
+// onto the low ones, an order below 2^31 takes a 64-bit product mod the constant, which the compiler turns into a
+// multiplication. main() picks these over WordFinite for the preset orders below
+template<unsigned long long P>
+class FixedFinite
+{
+    static_assert(P > 2 && P < (1ull << 63), "order out of range");
+    static_assert((P & (P + 1)) == 0 || P < (1ull << 31), "only Mersenne orders and orders below 2^31 are supported");
+
+    static const bool MERSENNE = (P & (P + 1)) == 0;
+    static const int BITS = MERSENNE ? 64 - __builtin_clzll(P) : 0;
+
+    // unreduced sums of products: 128 bits for a Mersenne order, 64 bits where a product is below 2^62
+    typedef typename std::conditional<MERSENNE, word_product, unsigned long long>::type sum_type;
+
+    // a sum that reaches 2^TOP is folded: the 64-bit one loses a multiple of P^2 that leaves it below 2P^2, the 128-bit
+    // one is reduced
+    static const int TOP = MERSENNE ? 126 : 63;
+    static const unsigned long long FOLD = MERSENNE ? 0 : (1ull << 63) / (P * P) * (P * P);
+
+    unsigned long long val;
+
+    friend class Accumulator<FixedFinite>;
+
+    // t mod P for any t below 2^127
+    static unsigned long long reduce(word_product t) noexcept
+    {
+        unsigned long long r;
+        if(MERSENNE)
+        {
+            // each fold keeps the residue as 2^BITS = 1; two leave less than 2P
+            word_product s = (t & P) + (t >> BITS);
+            r = static_cast<unsigned long long>((s & P) + (s >> BITS));
+            return r >= P ? r - P : r;
+        }
+        unsigned long long high = static_cast<unsigned long long>(t >> 64);
+        r = static_cast<unsigned long long>(t) % P;
+        if(high)
+            r = (high % P * ((0 - P) % P) % P + r) % P;
+        return r;
+    }
+
+    static unsigned long long mul(unsigned long long a, unsigned long long b) noexcept
+    {
+        if(MERSENNE)
+            return reduce(word_product(a) * b);
+        // no Solinas reduction here: with a constant P the compiler already turns the % into a multiplication
+        return a * b % P;
+    }
+
+    static void accumulate(sum_type &sum, unsigned long long a, unsigned long long b) noexcept
+    {
+        sum += sum_type(a) * b;
+        if(sum >> TOP)
+            sum = (MERSENNE ? sum_type(reduce(sum)) : sum - FOLD);
+    }
+
+public:
+    static const unsigned long long ORDER = P;
+
+    FixedFinite(const BigInteger &n): val(0)
+    {
+        long long r = static_cast<long long>(n % BigInteger(static_cast<long long>(P)));
+        val = static_cast<unsigned long long>(r < 0 ? r + static_cast<long long>(P) : r);
+    }
+
+    FixedFinite(int n) noexcept: val(0)
+    {
+        long long r = n % static_cast<long long>(P);
+        val = static_cast<unsigned long long>(r < 0 ? r + static_cast<long long>(P) : r);
+    }
+
+    FixedFinite() noexcept: val(0) {};
+
+    explicit operator const BigInteger() const noexcept
+    {
+        return BigInteger(static_cast<long long>(val));
+    }
+
+    explicit operator int() const noexcept
+    {
+        return int(static_cast<unsigned>(val));
+    }
+
+    explicit operator bool() const noexcept
+    {
+        return val != 0;
+    }
+
+    const FixedFinite operator-() const noexcept
+    {
+        return FixedFinite() - *this;
+    }
+
+    const FixedFinite operator+() const noexcept
+    {
+        return *this;
+    }
+
+    FixedFinite &operator+=(const FixedFinite &a) noexcept
+    {
+        val += a.val;
+        if(val >= P)
+            val -= P;
+        return *this;
+    }
+
+    const FixedFinite operator+(const FixedFinite &a) const noexcept
+    {
+        FixedFinite temp(*this);
+        return temp += a;
+    }
+
+    FixedFinite &operator-=(const FixedFinite &a) noexcept
+    {
+        val = (val >= a.val ? val - a.val : val + P - a.val);
+        return *this;
+    }
+
+    const FixedFinite operator-(const FixedFinite &a) const noexcept
+    {
+        FixedFinite temp(*this);
+        return temp -= a;
+    }
+
+    FixedFinite &operator*=(const FixedFinite &a) noexcept
+    {
+        val = mul(val, a.val);
+        return *this;
+    }
+
+    const FixedFinite operator*(const FixedFinite &a) const noexcept
+    {
+        FixedFinite temp(*this);
+        return temp *= a;
+    }
+
+    friend void addmul(FixedFinite &acc, const FixedFinite &x, const FixedFinite &y) noexcept
+    {
+        FixedFinite t(x);
+        acc += t *= y;
+    }
+
+    friend void submul(FixedFinite &acc, const FixedFinite &x, const FixedFinite &y) noexcept
+    {
+        FixedFinite t(x);
+        acc -= t *= y;
+    }
+
+    // extended Euclid as in WordContext::inverse, so that a composite order gives the same cofactor
+    const FixedFinite inverse() const
+    {
+        if(!val)
+            throw zero_division_error("Trying to invert zero");
+        unsigned long long u = P, v = val, y0 = 0, y1 = 1;
+        bool odd = false;
+        while(v)
+        {
+            unsigned long long q = u / v, t = u - q * v;
+            u = v;
+            v = t;
+            t = y0 + q * y1;
+            y0 = y1;
+            y1 = t;
+            odd = !odd;
+        }
+        y0 %= P;
+        FixedFinite res;
+        res.val = (odd || !y0 ? y0 : P - y0);
+        return res;
+    }
+
+    FixedFinite operator/=(const FixedFinite &a)
+    {
+        return *this *= a.inverse();
+    }
+
+    const FixedFinite operator/(const FixedFinite &a) const
+    {
+        return *this * a.inverse();
+    }
+
+    bool operator<(const FixedFinite &) const
+    {
+        throw invalid_number_error("Elements of a finite field are not ordered");
+    }
+
+    bool operator>(const FixedFinite &) const
+    {
+        throw invalid_number_error("Elements of a finite field are not ordered");
+    }
+
+    friend bool operator==(const FixedFinite &a, const FixedFinite &b) noexcept
+    {
+        return a.val == b.val;
+    }
+
+    friend bool operator!=(const FixedFinite &a, const FixedFinite &b) noexcept
+    {
+        return a.val != b.val;
+    }
+
+};
+
+// the preset orders: the NTT prime 119 * 2^23 + 1 and the Mersenne prime 2^61 - 1
+typedef FixedFinite<998244353> NttFinite;
+typedef FixedFinite<2305843009213693951ull> MersenneFinite;
+
+// the products are summed unreduced and reduced once
+template<unsigned long long P>
+class Accumulator<FixedFinite<P>>
+{
+    FixedFinite<P> base;
+    typename FixedFinite<P>::sum_type sum;
+
+public:
+    static const bool LAZY = true;
+
+    Accumulator(): base(), sum(0) {}
+
+    explicit Accumulator(const FixedFinite<P> &a): base(a), sum(0) {}
+
+    void add(const FixedFinite<P> &x, const FixedFinite<P> &y) noexcept
+    {
+        FixedFinite<P>::accumulate(sum, x.val, y.val);
+    }
+
+    void sub(const FixedFinite<P> &x, const FixedFinite<P> &y) noexcept
+    {
+        if(x.val)
+            FixedFinite<P>::accumulate(sum, P - x.val, y.val);
+    }
+
+    const FixedFinite<P> value() const noexcept
+    {
+        FixedFinite<P> res;
+        res.val = FixedFinite<P>::reduce(sum);
+        return res += base;
+    }
+};
+
+template<unsigned long long P>
+inline std::ostream &operator<<(std::ostream &out, const FixedFinite<P> &a)
+{
+    return out << BigInteger(a);
+}
+
+template<unsigned long long P>
+inline std::istream &operator>>(std::istream &in, FixedFinite<P> &a)
+{
+    BigInteger t;
+    in >> t;
+    a = t;
+    return in;
+}
+
+#endif
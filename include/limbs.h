@@ -0,0 +1,20 @@
+#ifndef _LIMBS_H
+#define _LIMBS_H
+
+#include <cstddef>
+
+// linear-time limb kernels; the first call picks AVX-512, AVX2 or portable code for the running CPU
+
+// res[0, n) = a[0, n) + b[0, n) + carry, returns the carry out
+unsigned limbsAdd(unsigned *res, const unsigned *a, const unsigned *b, size_t n, unsigned carry) noexcept;
+
+// res[0, n) = a[0, n) - b[0, n) - borrow, returns the borrow out
+unsigned limbsSub(unsigned *res, const unsigned *a, const unsigned *b, size_t n, unsigned borrow) noexcept;
+
+// res[0, n) = a[0, n) * m + carry, returns the carry limb
+unsigned limbsMul(unsigned *res, const unsigned *a, size_t n, unsigned m, unsigned carry) noexcept;
+
+// sign of a[0, n) - b[0, n)
+int limbsCompare(const unsigned *a, const unsigned *b, size_t n) noexcept;
+
+#endif
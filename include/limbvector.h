@@ -0,0 +1,219 @@
+#ifndef _LIMBVECTOR_H
+#define _LIMBVECTOR_H
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+// vector-like storage for BigInteger limbs, values of up to INLINE_SIZE limbs never touch the heap
+class LimbVector
+{
+public:
+    typedef unsigned value_type;
+    typedef unsigned *iterator;
+    typedef const unsigned *const_iterator;
+    typedef std::reverse_iterator<iterator> reverse_iterator;
+    typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+    static const unsigned INLINE_SIZE = 2;
+
+private:
+    unsigned *_data;
+    unsigned _size, _capacity;
+    unsigned _inline[INLINE_SIZE];
+
+    bool isInline() const noexcept
+    {
+        return _data == _inline;
+    }
+
+    void grow(size_t n)
+    {
+        size_t cap = std::max<size_t>(n, _capacity * 2ull);
+        unsigned *p = new unsigned[cap];
+        std::memcpy(p, _data, _size * sizeof(unsigned));
+        if(!isInline())
+            delete[] _data;
+        _data = p;
+        _capacity = static_cast<unsigned>(cap);
+    }
+
+public:
+    LimbVector() noexcept: _data(_inline), _size(0), _capacity(INLINE_SIZE), _inline() {}
+
+    LimbVector(const LimbVector &a): LimbVector()
+    {
+        *this = a;
+    }
+
+    LimbVector(LimbVector &&a) noexcept: LimbVector()
+    {
+        *this = std::move(a);
+    }
+
+    ~LimbVector()
+    {
+        if(!isInline())
+            delete[] _data;
+    }
+
+    LimbVector &operator=(const LimbVector &a)
+    {
+        if(this == &a)
+            return *this;
+        if(a._size > _capacity)
+            grow(a._size);
+        std::memcpy(_data, a._data, a._size * sizeof(unsigned));
+        _size = a._size;
+        return *this;
+    }
+
+    LimbVector &operator=(LimbVector &&a) noexcept
+    {
+        if(this == &a)
+            return *this;
+        if(a.isInline() || a._size <= _capacity)
+        {
+            std::memcpy(_data, a._data, a._size * sizeof(unsigned));
+            _size = a._size;
+            a._size = 0;
+            return *this;
+        }
+        if(!isInline())
+            delete[] _data;
+        _data = a._data;
+        _size = a._size;
+        _capacity = a._capacity;
+        a._data = a._inline;
+        a._size = 0;
+        a._capacity = INLINE_SIZE;
+        return *this;
+    }
+
+    size_t size() const noexcept
+    {
+        return _size;
+    }
+
+    bool empty() const noexcept
+    {
+        return !_size;
+    }
+
+    unsigned *data() noexcept
+    {
+        return _data;
+    }
+
+    const unsigned *data() const noexcept
+    {
+        return _data;
+    }
+
+    unsigned &operator[](size_t i) noexcept
+    {
+        return _data[i];
+    }
+
+    const unsigned &operator[](size_t i) const noexcept
+    {
+        return _data[i];
+    }
+
+    unsigned &back() noexcept
+    {
+        return _data[_size - 1];
+    }
+
+    const unsigned &back() const noexcept
+    {
+        return _data[_size - 1];
+    }
+
+    iterator begin() noexcept
+    {
+        return _data;
+    }
+
+    iterator end() noexcept
+    {
+        return _data + _size;
+    }
+
+    const_iterator begin() const noexcept
+    {
+        return _data;
+    }
+
+    const_iterator end() const noexcept
+    {
+        return _data + _size;
+    }
+
+    reverse_iterator rbegin() noexcept
+    {
+        return reverse_iterator(end());
+    }
+
+    reverse_iterator rend() noexcept
+    {
+        return reverse_iterator(begin());
+    }
+
+    const_reverse_iterator rbegin() const noexcept
+    {
+        return const_reverse_iterator(end());
+    }
+
+    const_reverse_iterator rend() const noexcept
+    {
+        return const_reverse_iterator(begin());
+    }
+
+    void reserve(size_t n)
+    {
+        if(n > _capacity)
+            grow(n);
+    }
+
+    void resize(size_t n)
+    {
+        reserve(n);
+        if(n > _size)
+            std::memset(_data + _size, 0, (n - _size) * sizeof(unsigned));
+        _size = static_cast<unsigned>(n);
+    }
+
+    void push_back(unsigned a)
+    {
+        if(_size == _capacity)
+            grow(_size + 1);
+        _data[_size++] = a;
+    }
+
+    void pop_back() noexcept
+    {
+        --_size;
+    }
+
+    void clear() noexcept
+    {
+        _size = 0;
+    }
+
+    void swap(LimbVector &a) noexcept
+    {
+        if(!isInline() && !a.isInline())
+        {
+            std::swap(_data, a._data);
+            std::swap(_size, a._size);
+            std::swap(_capacity, a._capacity);
+            return;
+        }
+        LimbVector temp(std::move(a));
+        a = std::move(*this);
+        *this = std::move(temp);
+    }
+};
+
+#endif
@@ -3,6 +3,7 @@
 
 #include <iostream>
 #include <cassert>
+#include <vector>
 #include "rational.h"
 
 class matrix_error: public std::runtime_error
@@ -205,4 +206,8 @@ inline std::istream &operator>>(std::istream &in, Matrix<Field> &a)
 template<class Field>
 void makeIntColumns(Matrix<Field> &m);
 
+// replaces every element with its inverse, all of them must be nonzero
+template<class Field>
+void invertAll(std::vector<Field> &a);
+
 #endif
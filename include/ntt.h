@@ -0,0 +1,12 @@
+#ifndef _NTT_H
+#define _NTT_H
+
+#include <cstddef>
+
+// nttMultiply is exact as long as the product has at most this many limbs
+const size_t NTT_MAX_LENGTH = size_t(1) << 24;
+
+// passing the same pointer and length for both operands computes a square with one transform less
+void nttMultiply(const unsigned *a, size_t na, const unsigned *b, size_t nb, unsigned *res);
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef _PACKED_H
+#define _PACKED_H
+
+#include <cstddef>
+
+// kernels for rows of residues held as doubles, used for moduli below 2^26 where a product of two residues is exact in
+// a double; the first call picks AVX2 with FMA or portable code for the running CPU
+
+// res[0, n) += c * a[0, n) without reduction; the caller keeps every value below 2^53 in magnitude
+void packedAxpy(double *res, const double *a, size_t n, double c) noexcept;
+
+// res[0, n) += sum of c[k] * a[k * stride, k * stride + n) over k < count, also without reduction
+void packedAxpyRows(double *res, const double *a, size_t stride, const double *c, size_t count, size_t n) noexcept;
+
+// res[0, n) = res[0, n) mod p, into [0, p), for integral values below 2^53 in magnitude
+void packedReduce(double *res, size_t n, double p) noexcept;
+
+// res[0, n) = res[0, n) * c mod p for residues res and c
+void packedScale(double *res, size_t n, double c, double p) noexcept;
+
+#endif
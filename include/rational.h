@@ -28,7 +28,9 @@ public:
 
     compare_t compare(const Rational &a) const
     {
-        return (_numerator * a._denominator - a._numerator * _denominator)._compare(0);
+        BigInteger diff = _numerator * a._denominator;
+        submul(diff, a._numerator, _denominator);
+        return diff._compare(0);
     }
 
     const BigInteger numerator() const
@@ -85,6 +87,10 @@ public:
 
     const std::string asDecimal(size_t precision) const;
 
+    friend void addmul(Rational &acc, const Rational &x, const Rational &y);
+
+    friend void submul(Rational &acc, const Rational &x, const Rational &y);
+
 };
 
 inline bool operator<(const Rational &a, const Rational &b)
@@ -129,4 +135,9 @@ std::ostream &operator<<(std::ostream &out, const Rational &a);
 
 std::istream &operator>>(std::istream &in, Rational &a);
 
+// acc += x * y and acc -= x * y, fused when all three are integers
+void addmul(Rational &acc, const Rational &x, const Rational &y);
+
+void submul(Rational &acc, const Rational &x, const Rational &y);
+
 #endif
@@ -0,0 +1,17 @@
+#ifndef _THREADPOOL_H
+#define _THREADPOOL_H
+
+#include <functional>
+#include <vector>
+
+// worker threads shared by the parallel parts of the arithmetic; 0 means one per hardware thread, 1 runs everything
+// on the calling thread. Must not be called while parallelRun is running
+void setThreadCount(unsigned n);
+
+unsigned threadCount();
+
+// runs the tasks and returns when all of them are done; the caller takes part and, while waiting, also runs queued
+// tasks of other callers, so tasks may call parallelRun themselves
+void parallelRun(const std::vector<std::function<void()>> &tasks);
+
+#endif
@@ -0,0 +1,329 @@
+#ifndef _WORDFINITE_H
+#define _WORDFINITE_H
+
+#include <iostream>
+#include <vector>
+#include "biginteger.h"
+#include "accumulator.h"
+
+// full product of two words; __extension__ keeps -pedantic quiet about the non-standard type
+__extension__ typedef unsigned __int128 word_product;
+
+// arithmetic modulo an order below 2^63 in machine words: an odd order keeps residues in Montgomery form
+// x * 2^64 mod p so that products are reduced without a division, an even one keeps plain residues
+class WordContext
+{
+    unsigned long long mod, inv, r2, fold;
+
+    // inverses of residues in the form indexed by the residue, 0 where not computed yet
+    mutable std::vector<unsigned> inverses;
+
+public:
+    // orders below this get a table with an inverse for every residue, filled as they are needed
+    static const unsigned long long TABLE_ORDER = 1 << 20;
+
+    // orders below this have their matrices multiplied and eliminated in doubles by the packed kernels
+    static const unsigned long long PACKED_ORDER = 1 << 26;
+
+    explicit WordContext(unsigned long long m): mod(m), inv(0), r2(0), fold((1ull << 63) / m * m), inverses()
+    {
+        if(m < TABLE_ORDER)
+            inverses.resize(m);
+        if(!(m & 1))
+            return;
+        // Newton iteration for m^-1 mod 2^64, an odd m is its own inverse modulo 8
+        unsigned long long x = m;
+        for(int i = 0; i < 5; ++i)
+            x *= 2 - m * x;
+        inv = 0 - x;
+        unsigned long long r = (0 - m) % m;
+        r2 = static_cast<unsigned long long>(word_product(r) * r % m);
+    }
+
+    unsigned long long modulus() const noexcept
+    {
+        return mod;
+    }
+
+    bool packed() const noexcept
+    {
+        return mod < PACKED_ORDER;
+    }
+
+    // t * 2^-64 mod m for t < m * 2^64 (t mod m for an even m); t + q * m stays below 2^128 as m < 2^63
+    unsigned long long reduce(word_product t) const noexcept
+    {
+        if(!inv)
+            return static_cast<unsigned long long>(t % mod);
+        unsigned long long q = static_cast<unsigned long long>(t) * inv;
+        unsigned long long r = static_cast<unsigned long long>((t + word_product(q) * mod) >> 64);
+        return r >= mod ? r - mod : r;
+    }
+
+    unsigned long long mul(unsigned long long a, unsigned long long b) const noexcept
+    {
+        return reduce(word_product(a) * b);
+    }
+
+    unsigned long long toForm(unsigned long long a) const noexcept
+    {
+        return inv ? mul(a, r2) : a;
+    }
+
+    unsigned long long fromForm(unsigned long long a) const noexcept
+    {
+        return inv ? reduce(a) : a;
+    }
+
+    // adds a * b to an unreduced sum. Each product is below 2^126, and once the sum reaches 2^127 the largest multiple
+    // of m * 2^64 not above 2^127 is taken off, which leaves the residue alone and the sum below 2^127 again
+    void accumulate(word_product &sum, unsigned long long a, unsigned long long b) const noexcept
+    {
+        sum += word_product(a) * b;
+        if(sum >> 127)
+            sum -= word_product(fold) << 64;
+    }
+
+    // the residue of an unreduced sum, as reduce() would give it
+    unsigned long long reduceSum(word_product sum) const noexcept
+    {
+        unsigned long long high = static_cast<unsigned long long>(sum >> 64);
+        if(high >= mod)
+            sum = (word_product(high % mod) << 64) | static_cast<unsigned long long>(sum);
+        return reduce(sum);
+    }
+
+    // extended Euclid on the plain residue of a nonzero a, giving the same cofactor as ext_gcd does for Finite when
+    // the order is composite and a is not a unit
+    unsigned long long inverse(unsigned long long a) const
+    {
+        if(a < inverses.size() && inverses[a])
+            return inverses[a];
+        unsigned long long u = mod, v = fromForm(a), y0 = 0, y1 = 1;
+        bool odd = false;
+        while(v)
+        {
+            unsigned long long q = u / v, t = u - q * v;
+            u = v;
+            v = t;
+            t = y0 + q * y1;
+            y0 = y1;
+            y1 = t;
+            odd = !odd;
+        }
+        y0 %= mod;
+        unsigned long long res = toForm(odd || !y0 ? y0 : mod - y0);
+        if(a < inverses.size())
+            inverses[a] = static_cast<unsigned>(res);
+        return res;
+    }
+};
+
+// set up in main() when the order fits in a word
+extern WordContext _WORD_CONTEXT;
+
+// Finite for orders below 2^63, main() picks it over Finite whenever the order allows
+class WordFinite
+{
+    unsigned long long val;
+
+    friend class Accumulator<WordFinite>;
+
+public:
+
+    WordFinite(const BigInteger &n): val(0)
+    {
+        long long p = static_cast<long long>(_WORD_CONTEXT.modulus());
+        long long r = static_cast<long long>(n % BigInteger(p));
+        if(r < 0)
+            r += p;
+        val = _WORD_CONTEXT.toForm(static_cast<unsigned long long>(r));
+    }
+
+    WordFinite(int n) noexcept: val(0)
+    {
+        long long p = static_cast<long long>(_WORD_CONTEXT.modulus()), r = n % p;
+        if(r < 0)
+            r += p;
+        val = _WORD_CONTEXT.toForm(static_cast<unsigned long long>(r));
+    }
+
+    WordFinite() noexcept: val(0) {};
+
+    // the residue in the form as a double, which is how the packed kernels hold it, and back
+    double packed() const noexcept
+    {
+        return double(val);
+    }
+
+    static WordFinite fromPacked(double a) noexcept
+    {
+        WordFinite res;
+        res.val = static_cast<unsigned long long>(a);
+        return res;
+    }
+
+    explicit operator const BigInteger() const noexcept
+    {
+        return BigInteger(static_cast<long long>(_WORD_CONTEXT.fromForm(val)));
+    }
+
+    explicit operator int() const noexcept
+    {
+        return int(static_cast<unsigned>(_WORD_CONTEXT.fromForm(val)));
+    }
+
+    explicit operator bool() const noexcept
+    {
+        return val != 0;
+    }
+
+    const WordFinite operator-() const noexcept
+    {
+        return WordFinite() - *this;
+    }
+
+    const WordFinite operator+() const noexcept
+    {
+        return *this;
+    }
+
+    WordFinite &operator+=(const WordFinite &a) noexcept
+    {
+        val += a.val;
+        if(val >= _WORD_CONTEXT.modulus())
+            val -= _WORD_CONTEXT.modulus();
+        return *this;
+    }
+
+    const WordFinite operator+(const WordFinite &a) const noexcept
+    {
+        WordFinite temp(*this);
+        return temp += a;
+    }
+
+    WordFinite &operator-=(const WordFinite &a) noexcept
+    {
+        val = (val >= a.val ? val - a.val : val + _WORD_CONTEXT.modulus() - a.val);
+        return *this;
+    }
+
+    const WordFinite operator-(const WordFinite &a) const noexcept
+    {
+        WordFinite temp(*this);
+        return temp -= a;
+    }
+
+    WordFinite &operator*=(const WordFinite &a) noexcept
+    {
+        val = _WORD_CONTEXT.mul(val, a.val);
+        return *this;
+    }
+
+    const WordFinite operator*(const WordFinite &a) const noexcept
+    {
+        WordFinite temp(*this);
+        return temp *= a;
+    }
+
+    friend void addmul(WordFinite &acc, const WordFinite &x, const WordFinite &y) noexcept
+    {
+        WordFinite t(x);
+        acc += t *= y;
+    }
+
+    friend void submul(WordFinite &acc, const WordFinite &x, const WordFinite &y) noexcept
+    {
+        WordFinite t(x);
+        acc -= t *= y;
+    }
+
+    const WordFinite inverse() const
+    {
+        if(!val)
+            throw zero_division_error("Trying to invert zero");
+        WordFinite res;
+        res.val = _WORD_CONTEXT.inverse(val);
+        return res;
+    }
+
+    WordFinite operator/=(const WordFinite &a)
+    {
+        return *this *= a.inverse();
+    }
+
+    const WordFinite operator/(const WordFinite &a) const
+    {
+        return *this * a.inverse();
+    }
+
+    bool operator<(const WordFinite &) const
+    {
+        throw invalid_number_error("Elements of a finite field are not ordered");
+    }
+
+    bool operator>(const WordFinite &) const
+    {
+        throw invalid_number_error("Elements of a finite field are not ordered");
+    }
+
+    friend bool operator==(const WordFinite &a, const WordFinite &b) noexcept
+    {
+        return a.val == b.val;
+    }
+
+    friend bool operator!=(const WordFinite &a, const WordFinite &b) noexcept
+    {
+        return a.val != b.val;
+    }
+
+};
+
+
+// the products are summed in 128 bits and reduced once
+template<>
+class Accumulator<WordFinite>
+{
+    WordFinite base;
+    word_product sum;
+
+public:
+    static const bool LAZY = true;
+
+    Accumulator(): base(), sum(0) {}
+
+    explicit Accumulator(const WordFinite &a): base(a), sum(0) {}
+
+    void add(const WordFinite &x, const WordFinite &y) noexcept
+    {
+        _WORD_CONTEXT.accumulate(sum, x.val, y.val);
+    }
+
+    void sub(const WordFinite &x, const WordFinite &y) noexcept
+    {
+        if(x.val)
+            _WORD_CONTEXT.accumulate(sum, _WORD_CONTEXT.modulus() - x.val, y.val);
+    }
+
+    const WordFinite value() const noexcept
+    {
+        WordFinite res;
+        res.val = _WORD_CONTEXT.reduceSum(sum);
+        return res += base;
+    }
+};
+
+inline std::ostream &operator<<(std::ostream &out, const WordFinite &a)
+{
+    return out << BigInteger(a);
+}
+
+inline std::istream &operator>>(std::istream &in, WordFinite &a)
+{
+    BigInteger t;
+    in >> t;
+    a = t;
+    return in;
+}
+
+#endif
@@ -1,5 +1,26 @@
 #include "biginteger.h"
+#include "ntt.h"
+#include "limbs.h"
+#include "threadpool.h"
 #include <algorithm>
+#include <cstdlib>
+
+const size_t karatsuba_threshold = 32;
+const size_t toom3_threshold = 256;
+const size_t toom4_threshold = 768;
+const size_t ntt_threshold = 4096;
+const size_t sqr_karatsuba_threshold = 48;
+const size_t sqr_toom3_threshold = 256;
+const size_t sqr_toom4_threshold = 768;
+const size_t sqr_ntt_threshold = 4096;
+const size_t bz_threshold = 64;
+const size_t divexact_threshold = 1024;
+const size_t hgcd_threshold = 512;
+const size_t radix_threshold = 32;
+// log2(10^9) ~ 29.89 bits per decimal chunk, in hundredths and rounded down
+const size_t chunk_bits_x100 = 2989;
+const size_t simd_threshold = 16;
+const size_t parallel_threshold = 512;
 
 void BigInteger::normalize() noexcept
 {
@@ -9,30 +30,37 @@ void BigInteger::normalize() noexcept
         negative = false;
 }
 
-void BigInteger::shiftRight(size_t a) noexcept
+void BigInteger::multiply(unsigned a) noexcept
 {
-    digits.resize(digits.size() + a);
-    for(size_t i = digits.size() - 1; i >= a; --i)
+    if(digits.size() >= simd_threshold)
     {
-        digits[i] = digits[i - a];
+        unsigned carry = limbsMul(digits.data(), digits.data(), digits.size(), a, 0);
+        if(carry)
+            digits.push_back(carry);
+        return;
     }
-    for(size_t i = 0; i < a; i++)
+    unsigned long long carry = 0;
+    for(size_t i = 0; i < digits.size(); i++)
     {
-        digits[i] = 0;
+        carry += digits[i] * 1ull * a;
+        digits[i] = static_cast<unsigned>(carry);
+        carry >>= LIMB_BITS;
     }
+    if(carry)
+        digits.push_back(static_cast<unsigned>(carry));
 }
 
-void BigInteger::multiply(unsigned a) noexcept
+void BigInteger::_add_abs(unsigned a) noexcept
 {
-    long long carry = 0;
-    for(size_t i = 0; carry || i < digits.size(); i++)
+    unsigned long long carry = a;
+    for(size_t i = 0; carry && i < digits.size(); i++)
     {
-        if(i >= digits.size())
-            digits.push_back(0);
-        long long new_carry = (digits[i] * 1ll * a + carry) / BLOCK_MOD;
-        digits[i] = (digits[i] * 1ll * a + carry) % BLOCK_MOD;
-        carry = new_carry;
+        carry += digits[i];
+        digits[i] = static_cast<unsigned>(carry);
+        carry >>= LIMB_BITS;
     }
+    if(carry)
+        digits.push_back(static_cast<unsigned>(carry));
 }
 
 compare_t BigInteger::_compareAbs(const BigInteger &a) const noexcept
@@ -41,177 +69,750 @@ compare_t BigInteger::_compareAbs(const BigInteger &a) const noexcept
         return CMP_LESS;
     if(digits.size() > a.digits.size())
         return CMP_GREATER;
-    for(size_t i = digits.size(); i > 0; --i)
+    return _compare_limbs(digits.data(), a.digits.data(), digits.size());
+}
+
+void BigInteger::_add_shifted(const BigInteger &a, size_t shift) noexcept
+{
+    if(digits.size() < a.digits.size() + shift)
+        digits.resize(a.digits.size() + shift);
+    unsigned long long carry = 0;
+    size_t i = 0;
+    for(; i < a.digits.size(); ++i)
     {
-        if(digits[i - 1] < a.digits[i - 1])
-            return CMP_LESS;
-        if(digits[i - 1] > a.digits[i - 1])
-            return CMP_GREATER;
+        carry += digits[i + shift] + 0ull + a.digits[i];
+        digits[i + shift] = static_cast<unsigned>(carry);
+        carry >>= LIMB_BITS;
     }
-    return CMP_EQUAL;
+    for(i += shift; carry && i < digits.size(); ++i)
+    {
+        carry += digits[i];
+        digits[i] = static_cast<unsigned>(carry);
+        carry >>= LIMB_BITS;
+    }
+    if(carry)
+        digits.push_back(static_cast<unsigned>(carry));
 }
 
-const BigInteger BigInteger::karatsuba(const BigInteger &a) const noexcept
+const BigInteger BigInteger::_slice(size_t from, size_t len) const noexcept
 {
-    if(a.digits.size() <= 1)
-    {
-        BigInteger res(*this);
-        res.multiply(a.digits[0]);
+    BigInteger res;
+    if(from >= digits.size())
         return res;
+    len = std::min(len, digits.size() - from);
+    res.digits.resize(len);
+    std::copy(digits.begin() + from, digits.begin() + from + len, res.digits.begin());
+    res.normalize();
+    return res;
+}
+
+void BigInteger::_shift_left(size_t bits) noexcept
+{
+    if(digits.empty())
+        return;
+    size_t limbs = bits / LIMB_BITS, old = digits.size();
+    digits.resize(old + limbs + 1);
+    std::copy_backward(digits.begin(), digits.begin() + old, digits.begin() + old + limbs);
+    std::fill(digits.begin(), digits.begin() + limbs, 0);
+    _shift_left_limbs(digits.data() + limbs, old + 1, bits % LIMB_BITS);
+    normalize();
+}
+
+void BigInteger::_shift_right(size_t bits) noexcept
+{
+    size_t limbs = bits / LIMB_BITS;
+    if(limbs >= digits.size())
+    {
+        digits.clear();
+        normalize();
+        return;
     }
-    size_t maxlen = std::max(digits.size(), a.digits.size());
-    maxlen += maxlen % 2;
-    BigInteger a1, a2, b1, b2;
-    a1.digits.reserve(maxlen / 2 + 1);
-    a2.digits.reserve(maxlen / 2 + 1);
-    b1.digits.reserve(maxlen / 2 + 1);
-    b2.digits.reserve(maxlen / 2 + 1);
-    for(size_t i = 0; i < maxlen; i++)
+    std::copy(digits.begin() + limbs, digits.end(), digits.begin());
+    digits.resize(digits.size() - limbs);
+    _shift_right_limbs(digits.data(), digits.size(), bits % LIMB_BITS);
+    normalize();
+}
+
+// column-by-column schoolbook product, carries are propagated once per output limb
+void BigInteger::_mul_basecase(unsigned *res, const unsigned *a, size_t na, const unsigned *b, size_t nb) noexcept
+{
+    unsigned long long low = 0, high = 0;
+    for(size_t k = 0; k + 1 < na + nb; ++k)
     {
-        if(i * 2 < maxlen)
+        size_t from = (k >= nb ? k - nb + 1 : 0), to = std::min(k + 1, na);
+        for(size_t i = from; i < to; ++i)
         {
-            a2.digits.push_back(i < digits.size() ? digits[i] : 0);
-            b2.digits.push_back(i < a.digits.size() ? a.digits[i] : 0);
+            unsigned long long p = a[i] * 1ull * b[k - i];
+            low += p;
+            high += low < p;
         }
-        else
+        res[k] = static_cast<unsigned>(low);
+        low = (low >> LIMB_BITS) | (high << LIMB_BITS);
+        high = 0;
+    }
+    res[na + nb - 1] = static_cast<unsigned>(low);
+}
+
+// schoolbook square: each off-diagonal product is computed once and doubled by a shift, then the squares are added
+void BigInteger::_sqr_basecase(unsigned *res, const unsigned *a, size_t n) noexcept
+{
+    std::fill(res, res + 2 * n, 0u);
+    for(size_t i = 0; i + 1 < n; ++i)
+        res[i + n] = _addmul_limb(res + 2 * i + 1, a + i + 1, n - i - 1, a[i]);
+    _shift_left_limbs(res, 2 * n, 1);
+    unsigned long long carry = 0;
+    for(size_t i = 0; i < n; ++i)
+    {
+        unsigned long long p = a[i] * 1ull * a[i];
+        carry += res[2 * i] + (p & 0xffffffffull);
+        res[2 * i] = static_cast<unsigned>(carry);
+        carry = (carry >> LIMB_BITS) + res[2 * i + 1] + (p >> LIMB_BITS);
+        res[2 * i + 1] = static_cast<unsigned>(carry);
+        carry >>= LIMB_BITS;
+    }
+}
+
+// product of absolute values, picks the algorithm by the length of the shorter operand
+const BigInteger BigInteger::_multiply(const BigInteger &a) const noexcept
+{
+    const BigInteger &big = (digits.size() >= a.digits.size() ? *this : a);
+    const BigInteger &small = (digits.size() >= a.digits.size() ? a : *this);
+    size_t len = small.digits.size();
+    if(this == &a)
+        return square();
+    if(!len)
+        return 0;
+    if(len == 1)
+    {
+        BigInteger res(big);
+        res.negative = false;
+        res.multiply(small.digits[0]);
+        return res;
+    }
+    if(len < karatsuba_threshold)
+    {
+        BigInteger res;
+        res.digits.resize(big.digits.size() + len);
+        _mul_basecase(res.digits.data(), big.digits.data(), big.digits.size(), small.digits.data(), len);
+        res.normalize();
+        return res;
+    }
+    if(len >= ntt_threshold && big.digits.size() + len <= NTT_MAX_LENGTH)
+        return big.ntt(small);
+    if(big.digits.size() >= 2 * len)
+        return big.unbalanced(small);
+    if(len < toom3_threshold)
+        return big.karatsuba(small);
+    if(len < toom4_threshold)
+        return big.toom3(small);
+    return big.toom4(small);
+}
+
+unsigned BigInteger::_add_limbs(unsigned *res, const unsigned *a, size_t na, const unsigned *b, size_t nb) noexcept
+{
+    unsigned long long carry = 0;
+    size_t i = 0;
+    if(nb >= simd_threshold)
+    {
+        carry = limbsAdd(res, a, b, nb, 0);
+        i = nb;
+    }
+    for(; i < nb; ++i)
+    {
+        carry += a[i] + 0ull + b[i];
+        res[i] = static_cast<unsigned>(carry);
+        carry >>= LIMB_BITS;
+    }
+    for(; i < na; ++i)
+    {
+        carry += a[i];
+        res[i] = static_cast<unsigned>(carry);
+        carry >>= LIMB_BITS;
+    }
+    return static_cast<unsigned>(carry);
+}
+
+unsigned BigInteger::_sub_limbs(unsigned *res, const unsigned *a, size_t na, const unsigned *b, size_t nb) noexcept
+{
+    unsigned borrow = 0;
+    size_t i = 0;
+    if(nb >= simd_threshold)
+    {
+        borrow = limbsSub(res, a, b, nb, 0);
+        i = nb;
+    }
+    for(; i < nb; ++i)
+    {
+        unsigned long long dig = b[i] + 0ull + borrow;
+        borrow = a[i] < dig;
+        res[i] = static_cast<unsigned>(a[i] - dig);
+    }
+    for(; i < na; ++i)
+    {
+        res[i] = a[i] - borrow;
+        borrow = borrow && !a[i];
+    }
+    return borrow;
+}
+
+// res[0, n) += a[0, n) * m, returns the carry limb
+unsigned BigInteger::_addmul_limb(unsigned *res, const unsigned *a, size_t n, unsigned m) noexcept
+{
+    unsigned long long carry = 0;
+    for(size_t i = 0; i < n; ++i)
+    {
+        carry += a[i] * 1ull * m + res[i];
+        res[i] = static_cast<unsigned>(carry);
+        carry >>= LIMB_BITS;
+    }
+    return static_cast<unsigned>(carry);
+}
+
+// res[0, n) -= a[0, n) * m, returns the limb still to be subtracted from res[n]
+unsigned BigInteger::_submul_limb(unsigned *res, const unsigned *a, size_t n, unsigned m) noexcept
+{
+    unsigned long long carry = 0;
+    for(size_t i = 0; i < n; ++i)
+    {
+        carry += a[i] * 1ull * m;
+        unsigned low = static_cast<unsigned>(carry);
+        carry = (carry >> LIMB_BITS) + (res[i] < low);
+        res[i] -= low;
+    }
+    return static_cast<unsigned>(carry);
+}
+
+void BigInteger::_shift_left_limbs(unsigned *a, size_t n, unsigned shift) noexcept
+{
+    if(!shift)
+        return;
+    for(size_t i = n; i-- > 1;)
+        a[i] = (a[i] << shift) | (a[i - 1] >> (LIMB_BITS - shift));
+    a[0] <<= shift;
+}
+
+void BigInteger::_shift_right_limbs(unsigned *a, size_t n, unsigned shift) noexcept
+{
+    if(!shift)
+        return;
+    for(size_t i = 0; i + 1 < n; ++i)
+        a[i] = (a[i] >> shift) | (a[i + 1] << (LIMB_BITS - shift));
+    a[n - 1] >>= shift;
+}
+
+compare_t BigInteger::_compare_limbs(const unsigned *a, const unsigned *b, size_t n) noexcept
+{
+    if(n >= simd_threshold)
+        return static_cast<compare_t>(limbsCompare(a, b, n));
+    for(size_t i = n; i > 0; --i)
+    {
+        if(a[i - 1] != b[i - 1])
+            return a[i - 1] < b[i - 1] ? CMP_LESS : CMP_GREATER;
+    }
+    return CMP_EQUAL;
+}
+
+// res[0, max(na, nb)) = |a - b|, returns true if a < b
+bool BigInteger::_diff_limbs(unsigned *res, const unsigned *a, size_t na, const unsigned *b, size_t nb) noexcept
+{
+    bool rev = false;
+    if(na < nb)
+    {
+        std::swap(a, b);
+        std::swap(na, nb);
+        rev = true;
+    }
+    size_t top = na;
+    while(top > nb && !a[top - 1])
+        --top;
+    if(top == nb && _compare_limbs(a, b, nb) == CMP_LESS)
+    {
+        _sub_limbs(res, b, nb, a, nb);
+        std::fill(res + nb, res + na, 0);
+        return !rev;
+    }
+    _sub_limbs(res, a, na, b, nb);
+    return rev;
+}
+
+size_t BigInteger::_karatsuba_scratch(size_t n) noexcept
+{
+    size_t res = 0;
+    for(; n >= karatsuba_threshold; n = (n + 1) / 2)
+        res += 6 * ((n + 1) / 2) + 1;
+    return res;
+}
+
+// res[0, 2n) = a[0, n) * b[0, n), scratch must hold _karatsuba_scratch(n) limbs
+void BigInteger::_karatsuba(unsigned *res, const unsigned *a, const unsigned *b, size_t n, unsigned *scratch) noexcept
+{
+    if(n < karatsuba_threshold)
+    {
+        _mul_basecase(res, a, n, b, n);
+        return;
+    }
+    size_t l = (n + 1) / 2, h = n - l;
+    unsigned *da = scratch, *db = da + l, *t = db + l, *mid = t + 2 * l, *next = mid + 2 * l + 1;
+    // a0 * b1 + a1 * b0 = a0 * b0 + a1 * b1 - (a0 - a1) * (b0 - b1)
+    bool sa = _diff_limbs(da, a, l, a + l, h);
+    bool sb = _diff_limbs(db, b, l, b + l, h);
+    _karatsuba(res, a, b, l, next);
+    _karatsuba(res + 2 * l, a + l, b + l, h, next);
+    _karatsuba(t, da, db, l, next);
+    mid[2 * l] = _add_limbs(mid, res, 2 * l, res + 2 * l, 2 * h);
+    if(sa == sb)
+        _sub_limbs(mid, mid, 2 * l + 1, t, 2 * l);
+    else
+        _add_limbs(mid, mid, 2 * l + 1, t, 2 * l);
+    _add_limbs(res + l, res + l, 2 * n - l, mid, std::min(2 * l + 1, 2 * n - l));
+}
+
+// res[0, 2n) = a[0, n)^2, the middle term a0^2 + a1^2 - (a0 - a1)^2 is never negative
+// scratch must hold _karatsuba_scratch(n) limbs, which is enough while sqr_karatsuba_threshold >= karatsuba_threshold
+void BigInteger::_karatsuba_sqr(unsigned *res, const unsigned *a, size_t n, unsigned *scratch) noexcept
+{
+    if(n < sqr_karatsuba_threshold)
+    {
+        _sqr_basecase(res, a, n);
+        return;
+    }
+    size_t l = (n + 1) / 2, h = n - l;
+    unsigned *da = scratch, *t = da + l, *mid = t + 2 * l, *next = mid + 2 * l + 1;
+    _diff_limbs(da, a, l, a + l, h);
+    _karatsuba_sqr(res, a, l, next);
+    _karatsuba_sqr(res + 2 * l, a + l, h, next);
+    _karatsuba_sqr(t, da, l, next);
+    mid[2 * l] = _add_limbs(mid, res, 2 * l, res + 2 * l, 2 * h);
+    _sub_limbs(mid, mid, 2 * l + 1, t, 2 * l);
+    _add_limbs(res + l, res + l, 2 * n - l, mid, std::min(2 * l + 1, 2 * n - l));
+}
+
+// the long operand is cut into pieces as long as the short one, so the cost is linear in the long length
+const BigInteger BigInteger::unbalanced(const BigInteger &a) const noexcept
+{
+    size_t len = a.digits.size();
+    BigInteger res;
+    res.digits.reserve(digits.size() + len);
+    if(len >= parallel_threshold && threadCount() > 1)
+    {
+        size_t pieces = (digits.size() + len - 1) / len;
+        std::vector<BigInteger> prod(pieces);
+        std::vector<std::function<void()>> tasks;
+        for(size_t i = 0; i < pieces; ++i)
+            tasks.push_back([this, &a, &prod, i, len] { prod[i] = _slice(i * len, len)._multiply(a); });
+        parallelRun(tasks);
+        for(size_t i = 0; i < pieces; ++i)
+            res._add_shifted(prod[i], i * len);
+    }
+    else
+    {
+        for(size_t from = 0; from < digits.size(); from += len)
         {
-            a1.digits.push_back(i < digits.size() ? digits[i] : 0);
-            b1.digits.push_back(i < a.digits.size() ? a.digits[i] : 0);
+            res._add_shifted(_slice(from, len)._multiply(a), from);
         }
     }
-    a1.normalize();
-    b1.normalize();
-    a2.normalize();
-    b2.normalize();
-    BigInteger a1b1 = a1.karatsuba(b1);
-    BigInteger a2b2 = a2.karatsuba(b2);
-    BigInteger sum = (a1 + a2).karatsuba(b1 + b2) - a1b1 - a2b2;
-    a1b1.shiftRight(maxlen);
-    sum.shiftRight(maxlen / 2);
-    return a1b1 + sum + a2b2;
+    res.normalize();
+    return res;
 }
 
-void BigInteger::_divide(int a, int &remainder)
+const BigInteger BigInteger::karatsuba(const BigInteger &a) const noexcept
 {
-    if(!a)
-        throw zero_division_error("Integer division by zero");
-    if(digits.empty())
+    size_t n = digits.size();
+    std::vector<unsigned> buf(n + _karatsuba_scratch(n));
+    std::copy(a.digits.begin(), a.digits.end(), buf.begin());
+    BigInteger res;
+    res.digits.resize(2 * n);
+    _karatsuba(res.digits.data(), digits.data(), buf.data(), n, buf.data() + n);
+    res.normalize();
+    return res;
+}
+
+// Toom-3 with evaluation points 0, 1, -1, -2, infinity and Bodrato's interpolation sequence
+const BigInteger BigInteger::toom3(const BigInteger &a) const noexcept
+{
+    size_t k = (std::max(digits.size(), a.digits.size()) + 2) / 3;
+    bool sqr = (this == &a);
+    BigInteger a0 = _slice(0, k), a1 = _slice(k, k), a2 = _slice(2 * k, k);
+    BigInteger b0 = a._slice(0, k), b1 = a._slice(k, k), b2 = a._slice(2 * k, k);
+    // the factors at 1, -1, -2, 0 and infinity
+    BigInteger x[5], y[5], r[5];
+    BigInteger ta = a0 + a2, tb = b0 + b2;
+    x[0] = ta + a1;
+    y[0] = tb + b1;
+    ta -= a1;
+    tb -= b1;
+    x[1] = ta;
+    y[1] = tb;
+    ta += a2;
+    tb += b2;
+    ta.multiply(2);
+    tb.multiply(2);
+    x[2] = ta - a0;
+    y[2] = tb - b0;
+    x[3] = a0;
+    y[3] = b0;
+    x[4] = a2;
+    y[4] = b2;
+    _multiply_pointwise(x, y, r, 5, sqr);
+    BigInteger &r1 = r[0], &rm1 = r[1], &rm2 = r[2], &r0 = r[3], &rinf = r[4];
+
+    BigInteger r3 = rm2 - r1;
+    r3._divide(3);
+    r1 -= rm1;
+    r1._divide_by_2();
+    BigInteger r2 = rm1 - r0;
+    r3 = r2 - r3;
+    r3._divide_by_2();
+    r3 += rinf * 2;
+    r2 += r1;
+    r2 -= rinf;
+    r1 -= r3;
+
+    BigInteger res(r0);
+    res._add_shifted(r1, k);
+    res._add_shifted(r2, 2 * k);
+    res._add_shifted(r3, 3 * k);
+    res._add_shifted(rinf, 4 * k);
+    return res;
+}
+
+// Toom-4 with evaluation points 0, 1, -1, 2, -2, 3, infinity
+const BigInteger BigInteger::toom4(const BigInteger &a) const noexcept
+{
+    size_t k = (std::max(digits.size(), a.digits.size()) + 3) / 4;
+    bool sqr = (this == &a);
+    BigInteger a0 = _slice(0, k), a1 = _slice(k, k), a2 = _slice(2 * k, k), a3 = _slice(3 * k, k);
+    BigInteger b0 = a._slice(0, k), b1 = a._slice(k, k), b2 = a._slice(2 * k, k), b3 = a._slice(3 * k, k);
+    // the factors at 1, -1, 2, -2, 3, 0 and infinity
+    BigInteger x[7], y[7], r[7];
+    BigInteger ea = a0 + a2, oa = a1 + a3, eb = b0 + b2, ob = b1 + b3;
+    x[0] = ea + oa;
+    y[0] = eb + ob;
+    x[1] = ea - oa;
+    y[1] = eb - ob;
+    ea = a0 + a2 * 4;
+    oa = a1 * 2 + a3 * 8;
+    eb = b0 + b2 * 4;
+    ob = b1 * 2 + b3 * 8;
+    x[2] = ea + oa;
+    y[2] = eb + ob;
+    x[3] = ea - oa;
+    y[3] = eb - ob;
+    x[4] = ((a3 * 3 + a2) * 3 + a1) * 3 + a0;
+    y[4] = ((b3 * 3 + b2) * 3 + b1) * 3 + b0;
+    x[5] = a0;
+    y[5] = b0;
+    x[6] = a3;
+    y[6] = b3;
+    _multiply_pointwise(x, y, r, 7, sqr);
+    BigInteger &r1 = r[0], &rm1 = r[1], &r2 = r[2], &rm2 = r[3], &r3 = r[4], &r0 = r[5], &rinf = r[6];
+
+    BigInteger e1 = r1 + rm1;
+    e1._divide_by_2();
+    e1 -= r0 + rinf;
+    BigInteger o1 = r1 - rm1;
+    o1._divide_by_2();
+    BigInteger e2 = r2 + rm2;
+    e2._divide_by_2();
+    e2 -= r0 + rinf * 64;
+    e2._divide(4);
+    BigInteger o2 = r2 - rm2;
+    o2._divide(4);
+    BigInteger c4 = e2 - e1;
+    c4._divide(3);
+    BigInteger c2 = e1 - c4;
+    r3 -= r0 + c2 * 9 + c4 * 81 + rinf * 729;
+    r3._divide(3);
+    BigInteger d1 = o2 - o1;
+    d1._divide(3);
+    BigInteger d2 = r3 - o1;
+    d2._divide(8);
+    BigInteger c5 = d2 - d1;
+    c5._divide(5);
+    BigInteger c3 = d1 - c5 * 5;
+    BigInteger c1 = o1 - c3 - c5;
+
+    BigInteger res(r0);
+    res._add_shifted(c1, k);
+    res._add_shifted(c2, 2 * k);
+    res._add_shifted(c3, 3 * k);
+    res._add_shifted(c4, 4 * k);
+    res._add_shifted(c5, 5 * k);
+    res._add_shifted(rinf, 6 * k);
+    return res;
+}
+
+// |this|^2, about a third cheaper than a general product of the same length
+const BigInteger BigInteger::square() const noexcept
+{
+    size_t n = digits.size();
+    BigInteger res;
+    if(n < sqr_karatsuba_threshold)
     {
-        remainder = 0;
-        return;
+        res.digits.resize(2 * n);
+        _sqr_basecase(res.digits.data(), digits.data(), n);
+        res.normalize();
+        return res;
+    }
+    if(n >= sqr_ntt_threshold && 2 * n <= NTT_MAX_LENGTH)
+        return ntt(*this);
+    if(n < sqr_toom3_threshold)
+    {
+        std::vector<unsigned> buf(_karatsuba_scratch(n));
+        res.digits.resize(2 * n);
+        _karatsuba_sqr(res.digits.data(), digits.data(), n, buf.data());
+        res.normalize();
+        return res;
     }
-    if(a < 0)
+    if(n < sqr_toom4_threshold)
+        return toom3(*this);
+    return toom4(*this);
+}
+
+// r[i] = x[i] * y[i], or x[i]^2 for a square; long factors are multiplied as parallel tasks
+void BigInteger::_multiply_pointwise(const BigInteger *x, const BigInteger *y, BigInteger *r, size_t n, bool sqr) noexcept
+{
+    if(x[0].digits.size() < parallel_threshold || threadCount() < 2)
     {
-        negative ^= 1;
-        a = -a;
+        for(size_t i = 0; i < n; ++i)
+            r[i] = sqr ? x[i].square() : x[i] * y[i];
+        return;
     }
-    long long carry = 0;
+    std::vector<std::function<void()>> tasks;
+    for(size_t i = 0; i < n; ++i)
+        tasks.push_back([x, y, r, i, sqr] { r[i] = sqr ? x[i].square() : x[i] * y[i]; });
+    parallelRun(tasks);
+}
+
+const BigInteger BigInteger::ntt(const BigInteger &a) const noexcept
+{
+    BigInteger res;
+    res.digits.resize(digits.size() + a.digits.size());
+    nttMultiply(digits.data(), digits.size(), a.digits.data(), a.digits.size(), res.digits.data());
+    res.normalize();
+    return res;
+}
+
+unsigned BigInteger::_divide(unsigned a) noexcept
+{
+    unsigned long long carry = 0;
     for(auto i = digits.rbegin(); i != digits.rend(); ++i)
     {
-        carry = carry * BLOCK_MOD + *i;
-        *i = carry / a;
+        carry = (carry << LIMB_BITS) | *i;
+        *i = static_cast<unsigned>(carry / a);
         carry %= a;
     }
-    remainder = static_cast<int>(carry);
     normalize();
+    return static_cast<unsigned>(carry);
 }
 
 void BigInteger::_divide_by_2() noexcept
 {
-    bool carry = false;
+    unsigned carry = 0;
     for(auto i = digits.rbegin(); i != digits.rend(); ++i)
     {
-        if(carry)
+        unsigned low = *i & 1;
+        *i = (*i >> 1) | (carry << (LIMB_BITS - 1));
+        carry = low;
+    }
+    normalize();
+}
+
+// Knuth's algorithm D: leaves the remainder in *this and returns the quotient, both as absolute values
+const BigInteger BigInteger::_divide_long(const BigInteger &a) noexcept
+{
+    negative = false;
+    if(_compareAbs(a) == CMP_LESS)
+        return 0;
+    size_t n = a.digits.size(), m = digits.size() - n;
+    if(n >= bz_threshold && m >= bz_threshold)
+        return _divide_bz(a);
+    unsigned shift = 0;
+    for(unsigned top = a.digits.back(); !(top >> (LIMB_BITS - 1)); top <<= 1)
+        ++shift;
+    LimbVector v(a.digits);
+    digits.push_back(0);
+    _shift_left_limbs(v.data(), n, shift);
+    _shift_left_limbs(digits.data(), digits.size(), shift);
+    unsigned *u = digits.data();
+    unsigned vtop = v[n - 1], vnext = (n > 1 ? v[n - 2] : 0);
+    BigInteger q;
+    q.digits.resize(m + 1);
+    for(size_t j = m + 1; j-- > 0;)
+    {
+        // estimate from the top two limbs, at most two too large after the correction loop
+        unsigned long long num = (static_cast<unsigned long long>(u[j + n]) << LIMB_BITS) | u[j + n - 1];
+        unsigned long long qhat = num / vtop, rhat = num % vtop;
+        while((qhat >> LIMB_BITS) || (n > 1 && qhat * vnext > ((rhat << LIMB_BITS) | u[j + n - 2])))
         {
-            carry = *i % 2;
-            *i = *i / 2 + BLOCK_MOD / 2;
+            --qhat;
+            rhat += vtop;
+            if(rhat >> LIMB_BITS)
+                break;
         }
-        else
+        unsigned borrow = _submul_limb(u + j, v.data(), n, static_cast<unsigned>(qhat));
+        if(u[j + n] < borrow)
         {
-            carry = *i % 2;
-            *i /= 2;
+            --qhat;
+            borrow -= _add_limbs(u + j, u + j, n, v.data(), n);
         }
+        u[j + n] -= borrow;
+        q.digits[j] = static_cast<unsigned>(qhat);
     }
+    _shift_right_limbs(u, n, shift);
     normalize();
+    q.normalize();
+    return q;
 }
 
-const BigInteger BigInteger::_divide_long(BigInteger a) noexcept
+// Burnikel-Ziegler: the dividend is cut into blocks of the divisor's length, each step is a 2n/n division
+const BigInteger BigInteger::_divide_bz(const BigInteger &a) noexcept
 {
-    negative = a.negative = false;
-    BigInteger ans;
-    if(_compareAbs(a) < 0)
-        return 0;
-    int shift = 0;
-    while(_compareAbs(a) >= 0)
-    {
-        a.digits.insert(a.digits.begin(), 0);
+    size_t n = a.digits.size(), shift = 0;
+    for(unsigned top = a.digits.back(); !(top >> (LIMB_BITS - 1)); top <<= 1)
         ++shift;
+    BigInteger b(a);
+    b.negative = negative = false;
+    b._shift_left(shift);
+    _shift_left(shift);
+    size_t blocks = (digits.size() + n - 1) / n;
+    BigInteger q, r = _slice((blocks - 1) * n, n);
+    if(r._compareAbs(b) != CMP_LESS)
+        r = 0;
+    else
+        --blocks;
+    while(blocks--)
+    {
+        r._shift_left(n * LIMB_BITS);
+        r._add_shifted(_slice(blocks * n, n), 0);
+        q._add_shifted(r._div2n1n(b, n), blocks * n);
     }
-    a.digits.erase(a.digits.begin());
-    ans.digits.reserve(shift);
-    for(; shift; --shift)
+    r._shift_right(shift);
+    swap(r);
+    q.normalize();
+    return q;
+}
+
+// *this < b * B^n, b has n limbs with the top bit set; leaves the remainder in *this
+const BigInteger BigInteger::_div2n1n(const BigInteger &b, size_t n) noexcept
+{
+    if(n < bz_threshold)
+        return _divide_long(b);
+    if(n % 2)
     {
-        int l = 0, r = BLOCK_MOD;
-        while(l + 1 < r)
-        {
-            int m = (l + r) / 2;
-            if(_compareAbs(a * m) < 0)
-                r = m;
-            else
-                l = m;
-        }
-        ans.digits.push_back(l);
-        *this -= a * l;
-        a.digits.erase(a.digits.begin());
+        BigInteger c(b);
+        c._shift_left(LIMB_BITS);
+        _shift_left(LIMB_BITS);
+        BigInteger q = _div2n1n(c, n + 1);
+        _shift_right(LIMB_BITS);
+        return q;
     }
-    std::reverse(ans.digits.begin(), ans.digits.end());
-    ans.normalize();
-    return ans;
+    size_t h = n / 2;
+    BigInteger b1 = b._slice(h, h), b2 = b._slice(0, h);
+    BigInteger a3 = _slice(h, h), a4 = _slice(0, h);
+    _shift_right(n * LIMB_BITS);
+    BigInteger q1 = _div3n2n(a3, b, b1, b2, h);
+    BigInteger q = _div3n2n(a4, b, b1, b2, h);
+    q._add_shifted(q1, h);
+    return q;
 }
 
-BigInteger::BigInteger(long long a) noexcept: digits(), negative(false)
+// divides (*this * B^n + a3) by b = b1 * B^n + b2, where *this < b * B^n
+const BigInteger BigInteger::_div3n2n(const BigInteger &a3, const BigInteger &b, const BigInteger &b1,
+                                      const BigInteger &b2, size_t n) noexcept
 {
-    if(a < 0)
+    BigInteger q;
+    if(_slice(n, digits.size())._compareAbs(b1) == CMP_EQUAL)
+    {
+        q.digits.resize(n);
+        std::fill(q.digits.begin(), q.digits.end(), ~0u);
+        BigInteger t(b1);
+        t._shift_left(n * LIMB_BITS);
+        *this -= t;
+        *this += b1;
+    }
+    else
+    {
+        q = _div2n1n(b1, n);
+    }
+    _shift_left(n * LIMB_BITS);
+    _add_shifted(a3, 0);
+    *this -= q * b2;
+    while(negative)
     {
-        negative = true;
-        a = -a;
+        --q;
+        *this += b;
     }
-    while(a)
+    return q;
+}
+
+BigInteger::BigInteger(long long a) noexcept: digits(), negative(a < 0)
+{
+    unsigned long long u = a < 0 ? 0ull - static_cast<unsigned long long>(a) : a;
+    while(u)
     {
-        digits.push_back(a % BLOCK_MOD);
-        a /= BLOCK_MOD;
+        digits.push_back(static_cast<unsigned>(u));
+        u >>= LIMB_BITS;
     }
 }
 
 BigInteger::BigInteger(const std::string &s): digits(), negative(false)
 {
-    unsigned temp = 0;
-    unsigned pow = 1;
-    for(auto i = s.crbegin(); i != s.crend(); ++i)
+    std::string num;
+    num.reserve(s.size());
+    for(char c : s)
     {
-        if(*i == '-' || *i == '+')
+        if(c == '-' || c == '+')
         {
-            if(*i == '-')
+            if(c == '-')
                 negative = true;
             continue;
         }
-        if(*i < '0' || *i > '9')
+        if(c < '0' || c > '9')
             throw invalid_number_error("Invalid integer: " + s);
-        temp += pow * (*i - '0');
-        pow *= 10;
-        if(pow == BLOCK_MOD)
-        {
-            pow = 1;
-            digits.push_back(temp);
-            temp = 0;
-        }
+        num += c;
     }
     if(s == "-")
-        temp = 1;
-    digits.push_back(temp);
+        num = "1";
+    digits = _parse_decimal(num.data(), num.size()).digits;
     normalize();
 }
 
+// 10^(DECIMAL_SIZE * 2^k), computed once and kept for later conversions
+const BigInteger &BigInteger::_decimal_power(size_t k)
+{
+    static std::vector<BigInteger> powers(1, BigInteger(DECIMAL_MOD));
+    while(powers.size() <= k)
+        powers.push_back(powers.back() * powers.back());
+    return powers[k];
+}
+
+// splits off the low DECIMAL_SIZE * 2^k digits until the pieces are short enough to be read block by block
+const BigInteger BigInteger::_parse_decimal(const char *s, size_t n)
+{
+    BigInteger res;
+    if(n <= radix_threshold * DECIMAL_SIZE)
+    {
+        size_t len = (n % DECIMAL_SIZE ? n % DECIMAL_SIZE : DECIMAL_SIZE);
+        for(size_t i = 0; i < n; i += len, len = DECIMAL_SIZE)
+        {
+            unsigned block = 0;
+            for(size_t j = 0; j < len; ++j)
+                block = block * 10 + (s[i + j] - '0');
+            res.multiply(DECIMAL_MOD);
+            res._add_abs(block);
+        }
+        return res;
+    }
+    size_t k = 0;
+    while((DECIMAL_SIZE << (k + 1)) < n)
+        ++k;
+    size_t low = DECIMAL_SIZE << k;
+    res = _parse_decimal(s, n - low) * _decimal_power(k);
+    res += _parse_decimal(s + n - low, low);
+    return res;
+}
+
 compare_t BigInteger::_compare(const BigInteger &a) const noexcept
 {
     if(negative && !a.negative)
@@ -221,74 +822,107 @@ compare_t BigInteger::_compare(const BigInteger &a) const noexcept
     return static_cast<compare_t>(_compareAbs(a) * (negative ? -1 : 1));
 }
 
+// appends the absolute value, which must be below 10^(DECIMAL_SIZE * 2^(k + 1)); with pad it takes exactly that many digits
+void BigInteger::_write_decimal(std::string &out, size_t k, bool pad) const
+{
+    if(digits.size() < radix_threshold)
+    {
+        std::vector<unsigned> blocks;
+        BigInteger temp(*this);
+        while(temp)
+            blocks.push_back(temp._divide(DECIMAL_MOD));
+        size_t width = DECIMAL_SIZE << (k + 1), start = out.size();
+        if(pad)
+            out.append(width - blocks.size() * DECIMAL_SIZE, '0');
+        for(auto i = blocks.rbegin(); i != blocks.rend(); ++i)
+        {
+            char block[DECIMAL_SIZE];
+            for(size_t j = DECIMAL_SIZE; j-- > 0; *i /= 10)
+                block[j] = static_cast<char>('0' + *i % 10);
+            size_t skip = 0;
+            if(!pad && out.size() == start)
+                while(skip + 1 < DECIMAL_SIZE && block[skip] == '0')
+                    ++skip;
+            out.append(block + skip, DECIMAL_SIZE - skip);
+        }
+        return;
+    }
+    BigInteger low(*this);
+    BigInteger high = low._divmod(_decimal_power(k));
+    if(pad || high)
+        high._write_decimal(out, k - 1, pad);
+    low._write_decimal(out, k - 1, pad || high);
+}
+
 std::string BigInteger::toString() const noexcept
 {
     if(digits.empty())
         return "0";
     std::string res = (negative ? "-" : "");
-    for(auto i = digits.rbegin(); i != digits.rend(); ++i)
+    size_t k = 0;
+    if(digits.size() >= radix_threshold)
     {
-        std::string temp = ::toString(*i);
-        if(i != digits.rbegin())
-        {
-            while(temp.length() < BLOCK_SIZE)
-            {
-                temp = "0" + temp;
-            }
-        }
-        res += temp;
+        // the smallest k whose power 2^(k + 1) chunks exceed the value, one too many at worst
+        size_t bits = _bit_length();
+        while(chunk_bits_x100 * (size_t(2) << k) < 100 * bits)
+            ++k;
+        if(k && _decimal_power(k)._compareAbs(*this) == CMP_GREATER)
+            --k;
     }
+    _write_decimal(res, k, false);
     return res;
 }
 
 BigInteger &BigInteger::operator+=(const BigInteger &a) noexcept
 {
     bool sub = negative ^a.negative;
-    int rem = 0;
+    size_t n = digits.size(), na = a.digits.size();
     if(!sub)  // addition
     {
-        for(size_t i = 0; i < std::max(a.digits.size(), digits.size()) || rem; ++i)
+        if(n < na)
         {
-            if(digits.size() <= i)
-                digits.push_back(0);
-            digits[i] = digits[i] + (a.digits.size() > i ? a.digits[i] : 0) + rem;
-            rem = digits[i] / BLOCK_MOD;
-            digits[i] %= BLOCK_MOD;
+            digits.resize(na);
+            unsigned carry = _add_limbs(digits.data(), a.digits.data(), na, digits.data(), n);
+            if(carry)
+                digits.push_back(carry);
         }
-    }
-    else
-    {
-        bool rev = _compareAbs(a) < 0;
-        const BigInteger &big = (rev ? a : *this), &small = (rev ? *this : a);
-        negative = big.negative;
-        for(size_t i = 0; i < a.digits.size() || rem; ++i)
+        else
         {
-            if(digits.size() <= i)
-                digits.push_back(0);
-            unsigned dig = (small.digits.size() > i ? small.digits[i] : 0);
-            if(big.digits[i] >= dig + rem)
+            unsigned long long carry = (na ? _add_limbs(digits.data(), digits.data(), na, a.digits.data(), na) : 0);
+            for(size_t i = na; carry && i < n; ++i)
             {
-                digits[i] = big.digits[i] - dig - rem;
-                rem = 0;
-            }
-            else
-            {
-                digits[i] = BLOCK_MOD + big.digits[i] - dig - rem;
-                rem = 1;
+                carry += digits[i];
+                digits[i] = static_cast<unsigned>(carry);
+                carry >>= LIMB_BITS;
             }
+            if(carry)
+                digits.push_back(static_cast<unsigned>(carry));
         }
     }
+    else if(_compareAbs(a) < 0)
+    {
+        digits.resize(na);
+        _sub_limbs(digits.data(), a.digits.data(), na, digits.data(), n);
+        negative = a.negative;
+    }
+    else
+    {
+        unsigned borrow = (na ? _sub_limbs(digits.data(), digits.data(), na, a.digits.data(), na) : 0);
+        for(size_t i = na; borrow && i < n; ++i)
+            borrow = !digits[i]--;
+    }
     normalize();
     return *this;
 }
 
-BigInteger &BigInteger::operator*=(BigInteger a) noexcept
+BigInteger &BigInteger::operator*=(const BigInteger &a) noexcept
 {
-    bool neg = negative ^a.negative;
-    if(_compareAbs(a) == CMP_LESS)
+    if(this == &a)
     {
-        std::swap(*this, a);
+        *this = square();
+        return *this;
     }
+    bool neg = negative ^a.negative;
     if(!a.digits.size())
     {
         digits.clear();
@@ -297,39 +931,170 @@ BigInteger &BigInteger::operator*=(BigInteger a) noexcept
     {
         multiply(a.digits[0]);
     }
+    else if(digits.size() == 1)
+    {
+        unsigned m = digits[0];
+        digits = a.digits;
+        multiply(m);
+    }
     else
     {
-        *this = karatsuba(a);
+        *this = _multiply(a);
     }
     negative = neg;
     normalize();
     return *this;
 }
 
-BigInteger &BigInteger::operator/=(const BigInteger &a)
+// *this += x * y, or -= with subtract, accumulated straight into the limbs while the shorter operand is short;
+// if the magnitude changes sign the top limb borrows out and the two's complement is taken in place
+void BigInteger::_addmul(const BigInteger &x, const BigInteger &y, bool subtract) noexcept
+{
+    const BigInteger &big = (x.digits.size() >= y.digits.size() ? x : y);
+    const BigInteger &small = (x.digits.size() >= y.digits.size() ? y : x);
+    size_t nb = big.digits.size(), ns = small.digits.size();
+    if(!ns)
+        return;
+    bool neg = x.negative ^ y.negative ^ subtract;
+    if(ns >= karatsuba_threshold || this == &x || this == &y)
+    {
+        BigInteger p = x._multiply(y);
+        p.negative = neg;
+        *this += p;
+        return;
+    }
+    if(digits.empty())
+        negative = neg;
+    size_t n = std::max(digits.size(), nb + ns) + 1;
+    digits.resize(n);
+    unsigned *d = digits.data();
+    if(negative == neg)
+    {
+        for(size_t i = 0; i < ns; ++i)
+        {
+            unsigned carry = _addmul_limb(d + i, big.digits.data(), nb, small.digits[i]);
+            for(size_t j = i + nb; carry; ++j)
+            {
+                d[j] += carry;
+                carry = d[j] < carry;
+            }
+        }
+    }
+    else
+    {
+        bool wrapped = false;
+        for(size_t i = 0; i < ns; ++i)
+        {
+            unsigned borrow = _submul_limb(d + i, big.digits.data(), nb, small.digits[i]);
+            for(size_t j = i + nb; borrow && j < n; ++j)
+            {
+                unsigned t = d[j];
+                d[j] = t - borrow;
+                borrow = t < borrow;
+            }
+            wrapped |= borrow;
+        }
+        if(wrapped)
+        {
+            unsigned long long carry = 1;
+            for(size_t i = 0; i < n; ++i)
+            {
+                carry += static_cast<unsigned>(~d[i]);
+                d[i] = static_cast<unsigned>(carry);
+                carry >>= LIMB_BITS;
+            }
+            negative = !negative;
+        }
+    }
+    normalize();
+}
+
+// truncating division: returns the quotient and leaves the remainder, with the sign of the dividend, in *this
+const BigInteger BigInteger::_divmod(const BigInteger &a)
 {
     if(!a)
         throw zero_division_error("Integer division by zero");
-    if(a.digits.size() <= 1)
+    bool neg = negative, qneg = negative ^a.negative;
+    BigInteger q;
+    if(a.digits.size() == 1)
     {
-        int temp;
-        negative ^= a.negative;
-        _divide(a.digits[0], temp);
-        return *this;
+        q.swap(*this);
+        *this = q._divide(a.digits[0]);
+    }
+    else
+    {
+        q = _divide_long(a);
+    }
+    negative = neg;
+    normalize();
+    q.negative = qneg;
+    q.normalize();
+    return q;
+}
+
+// *this /= a for an a known to divide *this: after the common power of two is shifted out, each quotient limb is
+// the low limb times the inverse of the divisor modulo 2^32, and only the limbs below the quotient length are kept
+void BigInteger::_divexact(const BigInteger &a)
+{
+    if(!a)
+        throw zero_division_error("Integer division by zero");
+    bool neg = negative ^a.negative;
+    size_t zeros = 0;
+    while(!a.digits[zeros / LIMB_BITS])
+        zeros += LIMB_BITS;
+    while(!((a.digits[zeros / LIMB_BITS] >> zeros % LIMB_BITS) & 1))
+        ++zeros;
+    BigInteger d(a);
+    d._shift_right(zeros);
+    _shift_right(zeros);
+    size_t n = d.digits.size();
+    if(digits.size() < n)
+    {
+        digits.clear();
+        normalize();
+        return;
+    }
+    size_t len = digits.size() - n + 1;
+    if(std::min(n, len) >= divexact_threshold)
+    {
+        *this = _divmod(d);
+        negative = neg;
+        normalize();
+        return;
+    }
+    // Newton iteration for d^-1 mod 2^32, an odd d is its own inverse modulo 8
+    unsigned inv = d.digits[0];
+    for(int i = 0; i < 4; ++i)
+        inv *= 2 - d.digits[0] * inv;
+    unsigned *r = digits.data();
+    for(size_t i = 0; i < len; ++i)
+    {
+        unsigned q = r[i] * inv;
+        size_t m = std::min(n, len - i);
+        unsigned borrow = _submul_limb(r + i, d.digits.data(), m, q);
+        for(size_t j = i + m; borrow && j < len; ++j)
+        {
+            unsigned t = r[j];
+            r[j] = t - borrow;
+            borrow = t < borrow;
+        }
+        r[i] = q;
     }
-    bool neg = a.negative ^negative;
-    *this = _divide_long(a);
+    digits.resize(len);
     negative = neg;
     normalize();
+}
+
+BigInteger &BigInteger::operator/=(const BigInteger &a)
+{
+    *this = _divmod(a);
     return *this;
 }
 
 BigInteger &BigInteger::operator%=(const BigInteger &a)
 {
-    BigInteger temp(*this);
-    temp /= a;
-    temp *= a;
-    return *this -= temp;
+    _divmod(a);
+    return *this;
 }
 
 BigInteger &BigInteger::operator-=(const BigInteger &a) noexcept
@@ -357,6 +1122,8 @@ const BigInteger operator-(const BigInteger &a, const BigInteger &b) noexcept
 
 const BigInteger operator*(const BigInteger &a, const BigInteger &b) noexcept
 {
+    if(&a == &b)
+        return a.square();
     BigInteger temp(a);
     temp *= b;
     return temp;
@@ -376,6 +1143,30 @@ const BigInteger operator%(const BigInteger &a, const BigInteger &b)
     return temp;
 }
 
+std::pair<BigInteger, BigInteger> divmod(const BigInteger &a, const BigInteger &b)
+{
+    BigInteger r(a);
+    BigInteger q = r._divmod(b);
+    return {q, r};
+}
+
+const BigInteger divexact(const BigInteger &a, const BigInteger &b)
+{
+    BigInteger temp(a);
+    temp._divexact(b);
+    return temp;
+}
+
+void addmul(BigInteger &acc, const BigInteger &x, const BigInteger &y) noexcept
+{
+    acc._addmul(x, y, false);
+}
+
+void submul(BigInteger &acc, const BigInteger &x, const BigInteger &y) noexcept
+{
+    acc._addmul(x, y, true);
+}
+
 std::ostream &operator<<(std::ostream &out, const BigInteger &a)
 {
     return out << a.toString();
@@ -390,93 +1181,378 @@ std::istream &operator>>(std::istream &in, BigInteger &a)
 }
 
 
-const BigInteger gcd(BigInteger a, BigInteger b) noexcept
+size_t BigInteger::_bit_length() const noexcept
+{
+    if(digits.empty())
+        return 0;
+    size_t res = digits.size() * LIMB_BITS;
+    for(unsigned top = digits.back(); !(top >> (LIMB_BITS - 1)); top <<= 1)
+        --res;
+    return res;
+}
+
+// bits [from, from + 64) of the absolute value
+unsigned long long BigInteger::_bits(size_t from) const noexcept
 {
-    BigInteger d = 1;
-    while(a && b)
+    size_t i = from / LIMB_BITS;
+    unsigned shift = from % LIMB_BITS;
+    unsigned long long res = 0;
+    for(size_t j = std::min(i + 3, digits.size()); j-- > i;)
     {
-        if(!a.odd() && !b.odd())
-        {
-            d *= 2;
-            a._divide_by_2();
-            b._divide_by_2();
-        }
-        else if(!a.odd())
-        {
-            a._divide_by_2();
-        }
-        else if(!b.odd())
-        {
-            b._divide_by_2();
-        }
-        else if(a >= b)
-        {
-            a -= b;
-        }
+        unsigned long long limb = digits[j];
+        if(j == i)
+            res |= limb >> shift;
         else
-        {
-            b -= a;
-        }
+            res |= limb << ((j - i) * LIMB_BITS - shift);
     }
-    return d * (a ? a : b);
+    return res;
 }
 
+const BigInteger BigInteger::_from_word(unsigned long long a) noexcept
+{
+    BigInteger res;
+    res.digits.push_back(static_cast<unsigned>(a));
+    res.digits.push_back(static_cast<unsigned>(a >> LIMB_BITS));
+    res.normalize();
+    return res;
+}
 
-std::pair<BigInteger, BigInteger> ext_gcd(BigInteger a, BigInteger b)
+const BigInteger BigInteger::_low_bits(size_t bits) const noexcept
 {
-    BigInteger u = 1, v = 0, s = 0, t = 1;
-    while(!a.odd() && !b.odd())
+    BigInteger res = _slice(0, (bits + LIMB_BITS - 1) / LIMB_BITS);
+    if(bits % LIMB_BITS && res.digits.size() * LIMB_BITS > bits)
     {
-        a /= 2;
-        b /= 2;
+        res.digits.back() &= (1u << (bits % LIMB_BITS)) - 1;
+        res.normalize();
     }
-    BigInteger alpha = a, beta = b;
-    while(!a.odd())
+    return res;
+}
+
+// x * mx + y * my for non-negative x and y
+const BigInteger BigInteger::_mul_add(const BigInteger &x, unsigned mx, const BigInteger &y, unsigned my) noexcept
+{
+    const BigInteger &big = (x.digits.size() >= y.digits.size() ? x : y), &small = (&big == &x ? y : x);
+    unsigned mb = (&big == &x ? mx : my), ms = (&big == &x ? my : mx);
+    size_t nb = big.digits.size(), ns = small.digits.size();
+    BigInteger res;
+    res.digits.resize(nb + 1);
+    unsigned *r = res.digits.data();
+    r[nb] = _addmul_limb(r, big.digits.data(), nb, mb);
+    unsigned carry = _addmul_limb(r, small.digits.data(), ns, ms);
+    if(carry)
+        _add_limbs(r + ns, r + ns, nb + 1 - ns, &carry, 1);
+    res.normalize();
+    return res;
+}
+
+// x * mx - y * my, the result must not be negative
+const BigInteger BigInteger::_mul_sub(const BigInteger &x, unsigned mx, const BigInteger &y, unsigned my) noexcept
+{
+    size_t nx = x.digits.size(), ny = y.digits.size(), len = std::max(nx, ny) + 1;
+    BigInteger res;
+    res.digits.resize(len);
+    unsigned *r = res.digits.data();
+    r[nx] = _addmul_limb(r, x.digits.data(), nx, mx);
+    unsigned borrow = _submul_limb(r, y.digits.data(), ny, my);
+    if(borrow)
+        _sub_limbs(r + ny, r + ny, len - ny, &borrow, 1);
+    res.normalize();
+    return res;
+}
+
+// m = m * r for 2x2 matrices stored row by row
+void BigInteger::_mul_matrix(BigInteger *m, const BigInteger *r) noexcept
+{
+    BigInteger t0 = m[0] * r[0] + m[1] * r[2], t1 = m[0] * r[1] + m[1] * r[3];
+    BigInteger t2 = m[2] * r[0] + m[3] * r[2], t3 = m[2] * r[1] + m[3] * r[3];
+    m[0].swap(t0);
+    m[1].swap(t1);
+    m[2].swap(t2);
+    m[3].swap(t3);
+}
+
+// One Lehmer round on the leading 62 bits, or a single division step when the round makes no progress.
+// Requires a >= b > 0; keeps b above 2^s and returns false if no such step exists.
+// If m is not null, the step is appended to it, so that the original pair is always m * (a, b).
+bool BigInteger::_gcd_step(BigInteger &a, BigInteger &b, BigInteger *m, size_t s) noexcept
+{
+    const long long limit = 1ll << LIMB_BITS;
+    size_t n = a._bit_length(), sh = (n > 62 ? n - 62 : 0);
+    long long x = static_cast<long long>(a._bits(sh)), y = static_cast<long long>(b._bits(sh));
+    // the approximated remainders are off by less than the cofactors, which stay below limit
+    long long bound = (s > sh ? (1ll << (s - sh)) + limit : 0);
+    long long A = 1, B = 0, C = 0, D = 1;
+    while(y + C > 0 && y + D > 0)
     {
-        a /= 2;
-        if(!u.odd() && !b.odd())
-        {
-            u /= 2;
-            v /= 2;
-        }
-        else
+        long long q = (x + A) / (y + C);
+        if(q != (x + B) / (y + D) || x - q * y < bound)
+            break;
+        if((C && q > (limit - 1 - std::abs(A)) / std::abs(C)) || q > (limit - 1 - std::abs(B)) / std::abs(D))
+            break;
+        long long t = A - q * C;
+        A = C;
+        C = t;
+        t = B - q * D;
+        B = D;
+        D = t;
+        t = x - q * y;
+        x = y;
+        y = t;
+    }
+    if(B)
+    {
+        unsigned a0 = static_cast<unsigned>(std::abs(A)), b0 = static_cast<unsigned>(std::abs(B));
+        unsigned c0 = static_cast<unsigned>(std::abs(C)), d0 = static_cast<unsigned>(std::abs(D));
+        BigInteger na = (A > 0 ? _mul_sub(a, a0, b, b0) : _mul_sub(b, b0, a, a0));
+        BigInteger nb = (C > 0 ? _mul_sub(a, c0, b, d0) : _mul_sub(b, d0, a, c0));
+        a.swap(na);
+        b.swap(nb);
+        if(m)
         {
-            u += beta;
-            u /= 2;
-            v -= alpha;
-            v /= 2;
+            BigInteger m0 = _mul_add(m[0], d0, m[1], c0), m2 = _mul_add(m[2], d0, m[3], c0);
+            m[1] = _mul_add(m[0], b0, m[1], a0);
+            m[3] = _mul_add(m[2], b0, m[3], a0);
+            m[0].swap(m0);
+            m[2].swap(m2);
         }
+        return true;
     }
-    while(a != b)
+    BigInteger r(a);
+    BigInteger q = r._divmod(b);
+    if(s && r._bit_length() <= s)
+        return false;
+    a.swap(b);
+    b.swap(r);
+    if(m)
     {
-        if(!b.odd())
+        BigInteger e[4] = {q, 1, 1, 0};
+        _mul_matrix(m, e);
+    }
+    return true;
+}
+
+// Half-gcd: reduces a >= b >= 0 until b drops to about half the length of a, via two recursive calls on the
+// leading halves. If m is not null, it receives the matrix of the reduction, the original pair being m * (a, b).
+void BigInteger::_hgcd(BigInteger &a, BigInteger &b, BigInteger *m) noexcept
+{
+    size_t n = a._bit_length(), s = n / 2 + 1;
+    if(m)
+    {
+        m[0] = m[3] = 1;
+        m[1] = m[2] = 0;
+    }
+    if(b._bit_length() <= s)
+        return;
+    if(a.digits.size() >= hgcd_threshold)
+    {
+        _hgcd_reduce(a, b, m, n / 2);
+        while(b._bit_length() > s && a._bit_length() > 3 * n / 4 + 1)
         {
-            b /= 2;
-            if(!s.odd() && !t.odd())
-            {
-                s /= 2;
-                t /= 2;
-            }
-            else
-            {
-                s += beta;
-                s /= 2;
-                t -= alpha;
-                t /= 2;
-            }
+            if(!_gcd_step(a, b, m, s))
+                return;
         }
-        else if(b < a)
+        size_t len = a._bit_length();
+        if(b._bit_length() > s && len > s + 2 * LIMB_BITS)
+            _hgcd_reduce(a, b, m, 2 * s + 1 - len);
+    }
+    while(b._bit_length() > s)
+    {
+        if(!_gcd_step(a, b, m, s))
+            return;
+    }
+}
+
+// runs _hgcd on the bits of a and b above p and applies the resulting matrix to the full numbers,
+// the matrix is dropped if it does not fit them
+void BigInteger::_hgcd_reduce(BigInteger &a, BigInteger &b, BigInteger *m, size_t p) noexcept
+{
+    BigInteger a0(a), b0(b), r[4];
+    a0._shift_right(p);
+    b0._shift_right(p);
+    _hgcd(a0, b0, r);
+    if(!r[1] && !r[2])
+        return;
+    // the leading parts are reduced already, only the low bits still need the matrix
+    BigInteger a1 = a._low_bits(p), b1 = b._low_bits(p);
+    BigInteger x = r[3] * a1 - r[1] * b1, y = r[0] * b1 - r[2] * a1;
+    // the determinant of r is 1 or -1, its low limb tells which
+    unsigned low[4];
+    for(int i = 0; i < 4; ++i)
+        low[i] = (r[i] ? r[i].digits[0] : 0);
+    if(low[0] * low[3] - low[1] * low[2] != 1)
+    {
+        x = -x;
+        y = -y;
+    }
+    a0._shift_left(p);
+    b0._shift_left(p);
+    x += a0;
+    y += b0;
+    if(x.negative || y.negative)
+        return;
+    if(x < y)
+    {
+        // the leading parts can end one quotient short, swapping keeps a >= b
+        x.swap(y);
+        r[0].swap(r[1]);
+        r[2].swap(r[3]);
+    }
+    a.swap(x);
+    b.swap(y);
+    if(m)
+        _mul_matrix(m, r);
+}
+
+const BigInteger gcd(BigInteger a, BigInteger b) noexcept
+{
+    a.negative = b.negative = false;
+    if(a < b)
+        a.swap(b);
+    while(b.digits.size() >= hgcd_threshold)
+    {
+        BigInteger::_hgcd(a, b, nullptr);
+        if(b)
+            BigInteger::_gcd_step(a, b, nullptr, 0);
+    }
+    while(b.digits.size() > 1)
+        BigInteger::_gcd_step(a, b, nullptr, 0);
+    if(!b)
+        return a;
+    unsigned x = b.digits[0], y = a._divide(x);
+    while(y)
+    {
+        x %= y;
+        std::swap(x, y);
+    }
+    return x;
+}
+
+
+// Bezout coefficients: a * first + b * second == gcd(a, b)
+std::pair<BigInteger, BigInteger> ext_gcd(BigInteger a, BigInteger b)
+{
+    bool neg_a = a.negative, neg_b = b.negative, swapped = a._compareAbs(b) == CMP_LESS;
+    a.negative = b.negative = false;
+    if(swapped)
+        a.swap(b);
+    BigInteger x, y;
+    if(a.digits.size() <= 2)
+    {
+        // the cofactors are bounded by the operands and fit in a word as well
+        unsigned long long u = a._bits(0), v = b._bits(0), x0 = 1, x1 = 0, y0 = 0, y1 = 1;
+        bool odd = false;
+        while(v)
         {
-            a.swap(b);
-            u.swap(s);
-            v.swap(t);
+            unsigned long long q = u / v, t = u - q * v;
+            u = v;
+            v = t;
+            t = x0 + q * x1;
+            x0 = x1;
+            x1 = t;
+            t = y0 + q * y1;
+            y0 = y1;
+            y1 = t;
+            odd = !odd;
         }
-        else
+        x = BigInteger::_from_word(x0);
+        y = BigInteger::_from_word(y0);
+        (odd ? x : y).negative = true;
+    }
+    else
+    {
+        BigInteger m[4] = {1, 0, 0, 1};
+        while(b.digits.size() >= hgcd_threshold)
         {
-            b -= a;
-            s -= u;
-            t -= v;
+            BigInteger r[4];
+            BigInteger::_hgcd(a, b, r);
+            BigInteger::_mul_matrix(m, r);
+            if(b)
+                BigInteger::_gcd_step(a, b, m, 0);
         }
+        while(b)
+            BigInteger::_gcd_step(a, b, m, 0);
+        // (a, b) = m * (gcd, 0), so the second row of the inverse of m gives the coefficients
+        unsigned low[4];
+        for(int i = 0; i < 4; ++i)
+            low[i] = (m[i] ? m[i].digits[0] : 0);
+        x.swap(m[3]);
+        y.swap(m[1]);
+        (low[0] * low[3] - low[1] * low[2] == 1 ? y : x).negative = true;
     }
-    return {s, t};
+    if(swapped)
+        x.swap(y);
+    x.negative ^= neg_a;
+    y.negative ^= neg_b;
+    x.normalize();
+    y.normalize();
+    return {x, y};
+}
+
+MontgomeryContext::MontgomeryContext(const BigInteger &m): mod(m), r2(), inv(0)
+{
+    if(!mod.odd())
+        return;
+    // Newton iteration for m^-1 mod 2^32 as in _divexact, the reduction adds multiples of -m^-1
+    unsigned x = mod.digits[0];
+    for(int i = 0; i < 4; ++i)
+        x *= 2 - mod.digits[0] * x;
+    inv = 0 - x;
+    r2 = 1;
+    r2._shift_left(2 * mod.digits.size() * BigInteger::LIMB_BITS);
+    r2 %= mod;
+}
+
+const BigInteger MontgomeryContext::toForm(const BigInteger &a) const
+{
+    if(!inv || !a)
+        return a;
+    BigInteger t = a * r2;
+    reduce(t);
+    return t;
+}
+
+const BigInteger MontgomeryContext::fromForm(const BigInteger &a) const
+{
+    BigInteger t(a);
+    reduce(t);
+    return t;
+}
+
+// each step clears the lowest limb by adding a multiple of m, then the n cleared limbs are dropped; the result is
+// below 2m
+void MontgomeryContext::reduce(BigInteger &a) const
+{
+    if(!inv)
+    {
+        if(a._compareAbs(mod) != CMP_LESS)
+            a %= mod;
+        return;
+    }
+    if(!a)
+        return;
+    size_t n = mod.digits.size();
+    const unsigned *m = mod.digits.data();
+    a.digits.resize(2 * n);
+    unsigned *t = a.digits.data(), top = 0;
+    for(size_t i = 0; i < n; ++i)
+    {
+        // the carry out of t[i + n] is held back until the next step adds to t[i + n + 1]
+        unsigned long long carry = BigInteger::_addmul_limb(t + i, m, n, t[i] * inv) + 0ull + t[i + n] + top;
+        t[i + n] = static_cast<unsigned>(carry);
+        top = static_cast<unsigned>(carry >> BigInteger::LIMB_BITS);
+    }
+    std::copy(t + n, t + 2 * n, t);
+    if(top || BigInteger::_compare_limbs(t, m, n) != CMP_LESS)
+        BigInteger::_sub_limbs(t, t, n, m, n);
+    a.digits.resize(n);
+    a.normalize();
+}
+
+// the cofactor of the plain residue, so that a non-unit modulo a composite m gets the same value as without the form
+const BigInteger MontgomeryContext::inverse(const BigInteger &a) const
+{
+    BigInteger x = ext_gcd(fromForm(a), mod).first;
+    if(x.negative)
+        x += mod;
+    return toForm(x);
 }
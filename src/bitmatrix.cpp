@@ -0,0 +1,543 @@
+#include "bitmatrix.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <sstream>
+
+typedef unsigned long long word;
+
+// a product with fewer rows adds the rows of the right matrix one by one instead of building tables
+const unsigned four_russians_threshold = 64;
+// width in words of the column blocks a product is cut into, so that its eight tables of 256 rows stay in cache
+const unsigned four_russians_block = 16;
+// words XORed by one step of a product or an elimination before the rows are shared between the threads
+const size_t bit_parallel_threshold = 1 << 18;
+
+static void _xorRow(word *dst, const word *src, unsigned n)
+{
+    for(unsigned i = 0; i < n; ++i)
+        dst[i] ^= src[i];
+}
+
+// runs f on parts of [0, n), one part per thread when the work is large enough
+template<class F>
+static void _forRanges(unsigned n, size_t work, const F &f)
+{
+    unsigned parts = std::min(n, threadCount());
+    if(work < bit_parallel_threshold || parts < 2)
+    {
+        f(0u, n);
+        return;
+    }
+    std::vector<std::function<void()>> tasks;
+    for(unsigned p = 0; p < parts; ++p)
+    {
+        unsigned lo = unsigned(size_t(n) * p / parts), hi = unsigned(size_t(n) * (p + 1) / parts);
+        tasks.push_back([&f, lo, hi] { f(lo, hi); });
+    }
+    parallelRun(tasks);
+}
+
+// table[x] is the XOR of rows[b] over the bits b of x < 256, a null row counts as zero; each new entry takes one XOR
+// from the entry without its lowest bit
+static void _buildTable(word *table, const word *const *rows, unsigned width)
+{
+    std::fill(table, table + width, 0ull);
+    for(unsigned x = 1; x < 256; ++x)
+    {
+        const word *prev = table + size_t(x & (x - 1)) * width, *row = rows[__builtin_ctz(x)];
+        word *dst = table + size_t(x) * width;
+        if(row)
+        {
+            for(unsigned i = 0; i < width; ++i)
+                dst[i] = prev[i] ^ row[i];
+        }
+        else
+            std::copy(prev, prev + width, dst);
+    }
+}
+
+// transposes a 64x64 block, bit j of a[i] being the element (i, j)
+static void _transpose64(word *a)
+{
+    word m = 0x00000000ffffffffull;
+    for(unsigned j = 32; j; j >>= 1, m ^= m << j)
+    {
+        for(unsigned k = 0; k < 64; k = (k + j + 1) & ~j)
+        {
+            word t = ((a[k] >> j) ^ a[k + j]) & m;
+            a[k] ^= t << j;
+            a[k + j] ^= t;
+        }
+    }
+}
+
+void Matrix<Bit>::_copyBits(word *dst, unsigned to, const word *src, unsigned from, unsigned count)
+{
+    for(unsigned done = 0; done < count; done += 64)
+    {
+        unsigned n = std::min(64u, count - done), s = from + done, d = to + done;
+        word x = src[s / 64] >> (s % 64);
+        if(s % 64 && s % 64 + n > 64)
+            x |= src[s / 64 + 1] << (64 - s % 64);
+        if(n < 64)
+            x &= (1ull << n) - 1;
+        dst[d / 64] |= x << (d % 64);
+        if(d % 64 && d % 64 + n > 64)
+            dst[d / 64 + 1] |= x >> (64 - d % 64);
+    }
+}
+
+// Gaussian elimination with pivots taken in the first cols columns, eight columns at a time. The pivots of a group are
+// found as the plain elimination would find them: a candidate row is brought up to date with the pivots found before
+// it only when it is looked at, and the pivot rows are kept as the plain elimination leaves them. Reduced copies of
+// them then fill a table of all 256 combinations, and every other row is cleared in these columns with one table row
+// picked by its byte there. The result is the same as of the plain elimination since the rows below are the only ones
+// that are zero in the pivot columns. reduced also clears the rows above and leaves the pivot rows reduced
+unsigned Matrix<Bit>::_eliminate(word *a, unsigned rows, unsigned width, unsigned cols, bool reduced,
+                                 std::vector<unsigned> *pivots)
+{
+    std::vector<word> table(256 * size_t(width)), copies(8 * size_t(width));
+    std::vector<unsigned> applied(rows);
+    unsigned row = 0;
+    for(unsigned c = 0; c < cols && row < rows; c += 8)
+    {
+        unsigned first = row, from = c / 64, count = 0, pcol[8];
+        std::fill(applied.begin() + row, applied.end(), 0);
+        for(unsigned col = c; col < std::min(c + 8, cols) && row < rows; ++col)
+        {
+            unsigned i = row;
+            for(; i < rows; ++i)
+            {
+                word *r = a + size_t(i) * width;
+                for(; applied[i] < count; ++applied[i])
+                {
+                    unsigned p = pcol[applied[i]];
+                    if(r[p / 64] >> (p % 64) & 1)
+                        _xorRow(r + from, a + size_t(first + applied[i]) * width + from, width - from);
+                }
+                if(r[col / 64] >> (col % 64) & 1)
+                    break;
+            }
+            if(i == rows)
+                continue;
+            if(i != row)
+            {
+                std::swap_ranges(a + size_t(i) * width + from, a + size_t(i + 1) * width, a + size_t(row) * width + from);
+                std::swap(applied[i], applied[row]);
+            }
+            pcol[count++] = col;
+            ++row;
+        }
+        if(!count)
+            continue;
+        unsigned w = width - from;
+        for(unsigned j = 0; j < count; ++j)
+            std::copy(a + size_t(first + j) * width + from, a + size_t(first + j + 1) * width, &copies[j * w]);
+        for(unsigned j = count - 1; j-- > 0;)
+        {
+            for(unsigned l = j + 1; l < count; ++l)
+            {
+                unsigned p = pcol[l] - from * 64;
+                if(copies[j * w + p / 64] >> (p % 64) & 1)
+                    _xorRow(&copies[j * w], &copies[l * w], w);
+            }
+        }
+        const word *byte_rows[8] = {};
+        for(unsigned j = 0; j < count; ++j)
+            byte_rows[pcol[j] - c] = &copies[j * w];
+        _buildTable(&table[0], byte_rows, w);
+        unsigned below = rows - row, above = (reduced ? first : 0);
+        _forRanges(below + above, size_t(below + above) * w, [&](unsigned lo, unsigned hi) {
+            for(unsigned k = lo; k < hi; ++k)
+            {
+                word *r = a + size_t(k < below ? row + k : k - below) * width + from;
+                unsigned x = unsigned(r[0] >> (c % 64)) & 255;
+                if(x)
+                    _xorRow(r, &table[size_t(x) * w], w);
+            }
+        });
+        if(reduced)
+        {
+            for(unsigned j = 0; j < count; ++j)
+                std::copy(&copies[j * w], &copies[(j + 1) * w], a + size_t(first + j) * width + from);
+        }
+        if(pivots)
+            pivots->insert(pivots->end(), pcol, pcol + count);
+    }
+    return row;
+}
+
+// elimination of this matrix with ext as extra columns that never hold a pivot
+unsigned Matrix<Bit>::_joinedGauss(Matrix &ext, bool reduced, std::vector<unsigned> *pivots)
+{
+    Matrix joined = joinHorizontal(ext);
+    unsigned rk = _eliminate(joined.arr, M, joined.W, N, reduced, pivots);
+    std::fill(ext.arr, ext.arr + size_t(M) * ext.W, 0ull);
+    for(unsigned i = 0; i < M; ++i)
+    {
+        std::copy(joined._row(i), joined._row(i) + W, _row(i));
+        if(N % 64)
+            _row(i)[W - 1] &= (1ull << N % 64) - 1;
+        _copyBits(ext._row(i), 0, joined._row(i), N, ext.N);
+    }
+    return rk;
+}
+
+// every 64 rows of a give eight tables of 256 combinations, and a word of a row of this matrix picks one row from each
+const Matrix<Bit> Matrix<Bit>::operator*(const Matrix &a) const
+{
+    if(N != a.M)
+        throw matrix_error("Trying to multiply matrices of different size");
+    Matrix res(M, a.N);
+    if(M < four_russians_threshold)
+    {
+        for(unsigned i = 0; i < M; ++i)
+        {
+            for(unsigned q = 0; q < N; ++q)
+            {
+                if(_row(i)[q / 64] >> (q % 64) & 1)
+                    _xorRow(res._row(i), a._row(q), a.W);
+            }
+        }
+        return res;
+    }
+    unsigned blocks = (a.W + four_russians_block - 1) / four_russians_block;
+    _forRanges(blocks, size_t(M) * W * a.W * 8, [&](unsigned lo, unsigned hi) {
+        std::vector<word> table(8 * 256 * four_russians_block);
+        for(unsigned b = lo; b < hi; ++b)
+        {
+            unsigned from = b * four_russians_block, width = std::min(a.W - from, four_russians_block);
+            for(unsigned s = 0; s < W; ++s)
+            {
+                for(unsigned t = 0; t < 8; ++t)
+                {
+                    const word *rows[8];
+                    for(unsigned q = 0; q < 8; ++q)
+                    {
+                        unsigned r = s * 64 + t * 8 + q;
+                        rows[q] = (r < a.M ? a._row(r) + from : nullptr);
+                    }
+                    _buildTable(&table[t * 256 * width], rows, width);
+                }
+                for(unsigned i = 0; i < M; ++i)
+                {
+                    word x = _row(i)[s];
+                    if(!x)
+                        continue;
+                    const word *t[8];
+                    for(unsigned k = 0; k < 8; ++k)
+                        t[k] = &table[(k * 256 + (x >> (8 * k) & 255)) * width];
+                    word *dst = res._row(i) + from;
+                    for(unsigned j = 0; j < width; ++j)
+                        dst[j] ^= t[0][j] ^ t[1][j] ^ t[2][j] ^ t[3][j] ^ t[4][j] ^ t[5][j] ^ t[6][j] ^ t[7][j];
+                }
+            }
+        }
+    });
+    return res;
+}
+
+Matrix<Bit>::Matrix(const Matrix &a): M(a.M), N(a.N), W(a.W), arr(new word[size_t(M) * W])
+{
+    std::copy(a.arr, a.arr + size_t(M) * W, arr);
+}
+
+const Matrix<Bit> Matrix<Bit>::fromRow(const std::string &s)
+{
+    std::istringstream iss;
+    iss.str(s);
+    Bit f;
+    std::vector<Bit> v;
+    while(iss >> f)
+        v.push_back(f);
+    if(v.empty())
+        return Matrix(1, 1);
+    Matrix m(1, v.size());
+    for(unsigned i = 0; i < v.size(); ++i)
+        m[0][i] = v[i];
+    return m;
+}
+
+Matrix<Bit> &Matrix<Bit>::operator=(const Matrix &a)
+{
+    if(arr == a.arr)
+        return *this;
+    Matrix temp(a);
+    swap(temp);
+    return *this;
+}
+
+unsigned Matrix<Bit>::gauss(Matrix *ext)
+{
+    if(!ext)
+        return _eliminate(arr, M, W, N, false, nullptr);
+    assert(M == ext->M);
+    return _joinedGauss(*ext, false, nullptr);
+}
+
+const Matrix<Bit> Matrix<Bit>::identity(unsigned n)
+{
+    Matrix res(n);
+    for(unsigned i = 0; i < n; ++i)
+    {
+        res[i][i] = 1;
+    }
+    return res;
+}
+
+Matrix<Bit> &Matrix<Bit>::operator+=(const Matrix &a)
+{
+    if(M != a.M || N != a.N)
+        throw matrix_error("Trying to add matrices of different size");
+    _xorRow(arr, a.arr, M * W);
+    return *this;
+}
+
+Matrix<Bit> &Matrix<Bit>::operator*=(Bit a)
+{
+    if(!a)
+        std::fill(arr, arr + size_t(M) * W, 0ull);
+    return *this;
+}
+
+const Bit Matrix<Bit>::det() const
+{
+    if(N != M)
+        throw matrix_error("Trying to calculate determinant of a non-square matrix");
+    return Bit(int(rank() == N));
+}
+
+const Matrix<Bit> Matrix<Bit>::transposed() const
+{
+    Matrix res(N, M);
+    word block[64];
+    for(unsigned i = 0; i < M; i += 64)
+    {
+        for(unsigned j = 0; j < W; ++j)
+        {
+            for(unsigned r = 0; r < 64; ++r)
+                block[r] = (i + r < M ? _row(i + r)[j] : 0);
+            _transpose64(block);
+            for(unsigned r = 0; r < 64 && j * 64 + r < N; ++r)
+                res._row(j * 64 + r)[i / 64] = block[r];
+        }
+    }
+    return res;
+}
+
+const Bit Matrix<Bit>::trace() const
+{
+    if(N != M)
+        throw matrix_error("Trying to calculate trace of a non-square matrix");
+    Bit ans;
+    for(unsigned i = 0; i < N; ++i)
+    {
+        ans += (*this)[i][i];
+    }
+    return ans;
+}
+
+const Matrix<Bit> Matrix<Bit>::inverted() const
+{
+    Matrix ext = Matrix::identity(N);
+    Matrix(*this).inverseExt(ext);
+    return ext;
+}
+
+bool Matrix<Bit>::operator==(const Matrix &a) const
+{
+    return M == a.M && N == a.N && std::equal(arr, arr + size_t(M) * W, a.arr);
+}
+
+const Matrix<Bit> Matrix<Bit>::submatrix(unsigned x1, unsigned y1, unsigned x2, unsigned y2) const
+{
+    if(x1 > x2)
+        std::swap(x1, x2);
+    if(y1 > y2)
+        std::swap(y1, y2);
+    Matrix res(x2 - x1 + 1, y2 - y1 + 1);
+    for(unsigned i = x1; i <= x2; ++i)
+    {
+        _copyBits(res._row(i - x1), 0, _row(i), y1, res.N);
+    }
+    return res;
+}
+
+// the reduced elimination leaves the identity on the left, so no back substitution is needed
+void Matrix<Bit>::inverseExt(Matrix &ext)
+{
+    if(N != M)
+        throw matrix_error("Trying to inverse a non-square matrix");
+    if(M != ext.M)
+    {
+        throw matrix_error("Invalid use of inverseExt");
+    }
+    if(_joinedGauss(ext, true, nullptr) != N)
+    {
+        throw matrix_error("Cannot inverse a singular matrix");
+    }
+}
+
+const Matrix<Bit> Matrix<Bit>::fundamental() const
+{
+    Matrix m(*this);
+    std::vector<unsigned> pivots;
+    unsigned rk = _eliminate(m.arr, M, W, N, true, &pivots);
+    std::vector<char> dependent(N);
+    for(unsigned p : pivots)
+        dependent[p] = 1;
+    Matrix ans(N, N - rk);
+    for(unsigned i = 0, cur = 0; i < N; ++i)
+    {
+        if(dependent[i])
+            continue;
+        for(unsigned k = 0; k < rk; ++k)
+        {
+            ans[pivots[k]][cur] = m[k][i];
+        }
+        ans[i][cur++] = 1;
+    }
+    return ans;
+}
+
+// the back substitution of the generic version, which may also take a free variable as one; it works on the columns
+// of the system, packed as rows of the transposed matrix
+const Matrix<Bit> Matrix<Bit>::partial() const
+{
+    if(N < 2)
+        throw matrix_error("Invalid matrix");
+    Matrix sys = submatrix(0, 0, M - 1, N - 2);
+    Matrix right = submatrix(0, N - 1, M - 1, N - 1);
+    Matrix ans(1, N - 1);
+    if(sys.gauss(&right) != rank())
+    {
+        return Matrix();
+    }
+    Matrix columns = sys.transposed(), rhs = right.transposed();
+    int row = M - 1;
+    for(int col = N - 2; col >= 0; --col)
+    {
+        while(row >= 0 && !sys[row][col])
+            --row;
+        if(row < 0)
+            return ans;
+        if(!rhs[0][row])
+            continue;
+        ans[0][col] = 1;
+        const word *c = columns._row(col);
+        word *r = rhs._row(0);
+        for(int i = 0; i < row / 64; ++i)
+            r[i] ^= c[i];
+        r[row / 64] ^= c[row / 64] & (~0ull >> (63 - row % 64));
+    }
+    return ans;
+}
+
+const Matrix<Bit> Matrix<Bit>::power(const BigInteger &pow) const
+{
+    if(M != N)
+        throw matrix_error("Power is only defined for square matrices");
+    Matrix t = identity(width());
+    bool t_set = false;
+    Matrix a(*this);
+    BigInteger p = abs(pow);
+    while(p)
+    {
+        if(p.odd())
+        {
+            if(t_set)
+                t *= a;
+            else
+                t = a;
+            t_set = true;
+        }
+        p._divide_by_2();
+        if(p)
+            a *= a;
+    }
+    return pow < 0 ? t.inverted() : t;
+}
+
+const Matrix<Bit> Matrix<Bit>::joinHorizontal(const Matrix &a) const
+{
+    if(M != a.M)
+    {
+        throw matrix_error("Trying to join matrices of different height");
+    }
+    Matrix res(M, N + a.N);
+    for(unsigned i = 0; i < M; i++)
+    {
+        std::copy(_row(i), _row(i) + W, res._row(i));
+        _copyBits(res._row(i), N, a._row(i), 0, a.N);
+    }
+    return res;
+}
+
+const Matrix<Bit> Matrix<Bit>::joinVertical(const Matrix &a) const
+{
+    if(N != a.N)
+    {
+        throw matrix_error("Trying to join matrices of different width");
+    }
+    Matrix res(M + a.M, N);
+    std::copy(arr, arr + size_t(M) * W, res.arr);
+    std::copy(a.arr, a.arr + size_t(a.M) * W, res._row(M));
+    return res;
+}
+
+const Matrix<Bit> Matrix<Bit>::charPolynom() const
+{
+    if(N != M)
+    {
+        throw matrix_error("Characteristic polynom is only defined for square matrices");
+    }
+    Matrix A(*this), B(identity(N));
+    Matrix ans(1, N + 1);
+    ans[0][0] = 1;
+    for(unsigned i = 1; i <= N; ++i)
+    {
+        A = *this * B;
+        Bit p = A.trace() / i;
+        B = A - identity(N) * p;
+        ans[0][i] = -p;
+    }
+    return ans;
+}
+
+// over a field the diagonal form has as many ones as the rank
+const Matrix<Bit> Matrix<Bit>::intDiagonal() const
+{
+    Matrix res(M, N);
+    for(unsigned i = rank(); i--;)
+    {
+        res[i][i] = 1;
+    }
+    return res;
+}
+
+void Matrix<Bit>::_write_to_ostream(std::ostream &out) const
+{
+    if(!N || !M)
+        return;
+    std::string s(2 * N, ' ');
+    s.back() = '\n';
+    for(unsigned i = 0; i < M; ++i)
+    {
+        for(unsigned j = 0; j < N; ++j)
+            s[2 * j] = char('0' + int((*this)[i][j]));
+        out << s;
+    }
+}
+
+void Matrix<Bit>::_read_from_istream(std::istream &in)
+{
+    Bit b;
+    for(unsigned i = 0; i < M; ++i)
+    {
+        for(unsigned j = 0; j < N; ++j)
+        {
+            in >> b;
+            (*this)[i][j] = b;
+        }
+    }
+}
@@ -83,9 +83,11 @@ Complex &Complex::operator-=(const Complex &a)
 
 Complex &Complex::operator*=(const Complex &a)
 {
-    Rational new_re = _re * a._re - _im * a._im;
-    _im = _re * a._im + _im * a._re;
+    Rational new_re = _re * a._re, new_im = _re * a._im;
+    submul(new_re, _im, a._im);
+    addmul(new_im, _im, a._re);
     _re = std::move(new_re);
+    _im = std::move(new_im);
     return *this;
 }
 
@@ -94,6 +96,33 @@ Complex &Complex::operator/=(const Complex &a)
     return *this *= a.inverse();
 }
 
+// the parts of acc are updated in place, so acc must not be one of the factors
+void addmul(Complex &acc, const Complex &x, const Complex &y)
+{
+    if(&acc == &x || &acc == &y)
+    {
+        acc += x * y;
+        return;
+    }
+    addmul(acc._re, x._re, y._re);
+    submul(acc._re, x._im, y._im);
+    addmul(acc._im, x._re, y._im);
+    addmul(acc._im, x._im, y._re);
+}
+
+void submul(Complex &acc, const Complex &x, const Complex &y)
+{
+    if(&acc == &x || &acc == &y)
+    {
+        acc -= x * y;
+        return;
+    }
+    submul(acc._re, x._re, y._re);
+    addmul(acc._re, x._im, y._im);
+    submul(acc._im, x._re, y._im);
+    submul(acc._im, x._im, y._re);
+}
+
 const Complex operator+(const Complex &a, const Complex &b)
 {
     Complex t = a;
@@ -0,0 +1,242 @@
+#include "limbs.h"
+#include "dispatch.h"
+
+static unsigned addPortable(unsigned *res, const unsigned *a, const unsigned *b, size_t n, unsigned carry) noexcept
+{
+    unsigned long long c = carry;
+    for(size_t i = 0; i < n; ++i)
+    {
+        c += a[i] + 0ull + b[i];
+        res[i] = static_cast<unsigned>(c);
+        c >>= 32;
+    }
+    return static_cast<unsigned>(c);
+}
+
+static unsigned subPortable(unsigned *res, const unsigned *a, const unsigned *b, size_t n, unsigned borrow) noexcept
+{
+    for(size_t i = 0; i < n; ++i)
+    {
+        unsigned long long dig = b[i] + 0ull + borrow;
+        borrow = a[i] < dig;
+        res[i] = static_cast<unsigned>(a[i] - dig);
+    }
+    return borrow;
+}
+
+static unsigned mulPortable(unsigned *res, const unsigned *a, size_t n, unsigned m, unsigned carry) noexcept
+{
+    unsigned long long c = carry;
+    for(size_t i = 0; i < n; ++i)
+    {
+        c += a[i] * 1ull * m;
+        res[i] = static_cast<unsigned>(c);
+        c >>= 32;
+    }
+    return static_cast<unsigned>(c);
+}
+
+static int comparePortable(const unsigned *a, const unsigned *b, size_t n) noexcept
+{
+    for(size_t i = n; i > 0; --i)
+    {
+        if(a[i - 1] != b[i - 1])
+            return a[i - 1] < b[i - 1] ? -1 : 1;
+    }
+    return 0;
+}
+
+#ifdef DISPATCH_X86
+
+// The vector kernels add lane by lane and then settle the carries of a whole block at once. A lane generates a carry
+// if its sum wrapped and propagates one if its sum is all ones; with G and P as bit masks over the lanes, the lanes
+// receiving a carry are ((G << 1 | carry_in) + P) ^ P, and the bit just above the block is the carry out.
+
+__attribute__((target("avx2")))
+static unsigned addAvx2(unsigned *res, const unsigned *a, const unsigned *b, size_t n, unsigned carry) noexcept
+{
+    const __m256i bias = _mm256_set1_epi32(int(0x80000000u)), ones = _mm256_set1_epi32(-1);
+    const __m256i shifts = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), one = _mm256_set1_epi32(1);
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8)
+    {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+        __m256i s = _mm256_add_epi32(x, y);
+        __m256i g = _mm256_cmpgt_epi32(_mm256_xor_si256(x, bias), _mm256_xor_si256(s, bias));
+        __m256i p = _mm256_cmpeq_epi32(s, ones);
+        unsigned gm = _mm256_movemask_ps(_mm256_castsi256_ps(g)), pm = _mm256_movemask_ps(_mm256_castsi256_ps(p));
+        unsigned t = ((gm << 1) | carry) + pm;
+        __m256i c = _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32(int(t ^ pm)), shifts), one);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(res + i), _mm256_add_epi32(s, c));
+        carry = t >> 8;
+    }
+    return addPortable(res + i, a + i, b + i, n - i, carry);
+}
+
+// a lane borrows if x < y and passes a borrow on if its difference is zero
+__attribute__((target("avx2")))
+static unsigned subAvx2(unsigned *res, const unsigned *a, const unsigned *b, size_t n, unsigned borrow) noexcept
+{
+    const __m256i bias = _mm256_set1_epi32(int(0x80000000u)), zero = _mm256_setzero_si256();
+    const __m256i shifts = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), one = _mm256_set1_epi32(1);
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8)
+    {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+        __m256i d = _mm256_sub_epi32(x, y);
+        __m256i g = _mm256_cmpgt_epi32(_mm256_xor_si256(y, bias), _mm256_xor_si256(x, bias));
+        __m256i p = _mm256_cmpeq_epi32(d, zero);
+        unsigned gm = _mm256_movemask_ps(_mm256_castsi256_ps(g)), pm = _mm256_movemask_ps(_mm256_castsi256_ps(p));
+        unsigned t = ((gm << 1) | borrow) + pm;
+        __m256i c = _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32(int(t ^ pm)), shifts), one);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(res + i), _mm256_sub_epi32(d, c));
+        borrow = t >> 8;
+    }
+    return subPortable(res + i, a + i, b + i, n - i, borrow);
+}
+
+__attribute__((target("avx2")))
+static int compareAvx2(const unsigned *a, const unsigned *b, size_t n) noexcept
+{
+    for(; n >= 8; n -= 8)
+    {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + n - 8));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + n - 8));
+        if(_mm256_movemask_epi8(_mm256_cmpeq_epi32(x, y)) != -1)
+            return comparePortable(a + n - 8, b + n - 8, 8);
+    }
+    return comparePortable(a, b, n);
+}
+
+__attribute__((target("avx512f")))
+static unsigned addAvx512(unsigned *res, const unsigned *a, const unsigned *b, size_t n, unsigned carry) noexcept
+{
+    const __m512i ones = _mm512_set1_epi32(-1), one = _mm512_set1_epi32(1);
+    size_t i = 0;
+    for(; i + 16 <= n; i += 16)
+    {
+        __m512i x = _mm512_loadu_si512(a + i), y = _mm512_loadu_si512(b + i);
+        __m512i s = _mm512_add_epi32(x, y);
+        unsigned gm = _mm512_cmplt_epu32_mask(s, x), pm = _mm512_cmpeq_epi32_mask(s, ones);
+        unsigned t = ((gm << 1) | carry) + pm;
+        _mm512_storeu_si512(res + i, _mm512_mask_add_epi32(s, __mmask16(t ^ pm), s, one));
+        carry = t >> 16;
+    }
+    return addAvx2(res + i, a + i, b + i, n - i, carry);
+}
+
+__attribute__((target("avx512f")))
+static unsigned subAvx512(unsigned *res, const unsigned *a, const unsigned *b, size_t n, unsigned borrow) noexcept
+{
+    const __m512i zero = _mm512_setzero_si512(), one = _mm512_set1_epi32(1);
+    size_t i = 0;
+    for(; i + 16 <= n; i += 16)
+    {
+        __m512i x = _mm512_loadu_si512(a + i), y = _mm512_loadu_si512(b + i);
+        __m512i d = _mm512_sub_epi32(x, y);
+        unsigned gm = _mm512_cmplt_epu32_mask(x, y), pm = _mm512_cmpeq_epi32_mask(d, zero);
+        unsigned t = ((gm << 1) | borrow) + pm;
+        _mm512_storeu_si512(res + i, _mm512_mask_sub_epi32(d, __mmask16(t ^ pm), d, one));
+        borrow = t >> 16;
+    }
+    return subAvx2(res + i, a + i, b + i, n - i, borrow);
+}
+
+// the 64-bit products of the even and odd lanes are split into a low and a high vector, the high one moves up a lane
+// with the incoming carry limb in lane 0, and the two are added like in addAvx512; with AVX2 alone the shuffles cost
+// as much as the scalar multiply, so that kernel set keeps mulPortable
+__attribute__((target("avx512f")))
+static unsigned mulAvx512(unsigned *res, const unsigned *a, size_t n, unsigned m, unsigned carry) noexcept
+{
+    const __m512i ones = _mm512_set1_epi32(-1), one = _mm512_set1_epi32(1), vm = _mm512_set1_epi32(int(m));
+    const __m512i up = _mm512_setr_epi32(15, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14);
+    size_t i = 0;
+    for(; i + 16 <= n; i += 16)
+    {
+        __m512i x = _mm512_loadu_si512(a + i);
+        // the zero-masking forms with a full mask keep GCC from warning about the unmasked ones' undefined operand
+        __m512i even = _mm512_maskz_mul_epu32(0xff, x, vm);
+        __m512i odd = _mm512_maskz_mul_epu32(0xff, _mm512_maskz_srli_epi64(0xff, x, 32), vm);
+        __m512i low = _mm512_mask_blend_epi32(0xaaaa, even, _mm512_maskz_slli_epi64(0xff, odd, 32));
+        __m512i high = _mm512_mask_blend_epi32(0xaaaa, _mm512_maskz_srli_epi64(0xff, even, 32), odd);
+        high = _mm512_maskz_permutexvar_epi32(0xffff, up, high);
+        unsigned top = static_cast<unsigned>(_mm512_cvtsi512_si32(high));
+        high = _mm512_mask_set1_epi32(high, 0x0001, int(carry));
+        __m512i s = _mm512_add_epi32(low, high);
+        unsigned gm = _mm512_cmplt_epu32_mask(s, low), pm = _mm512_cmpeq_epi32_mask(s, ones);
+        unsigned t = (gm << 1) + pm;
+        _mm512_storeu_si512(res + i, _mm512_mask_add_epi32(s, __mmask16(t ^ pm), s, one));
+        carry = top + (t >> 16);
+    }
+    return mulPortable(res + i, a + i, n - i, m, carry);
+}
+
+__attribute__((target("avx512f")))
+static int compareAvx512(const unsigned *a, const unsigned *b, size_t n) noexcept
+{
+    for(; n >= 16; n -= 16)
+    {
+        __m512i x = _mm512_loadu_si512(a + n - 16), y = _mm512_loadu_si512(b + n - 16);
+        unsigned diff = _mm512_cmpneq_epi32_mask(x, y);
+        if(diff)
+        {
+            size_t i = n - 16 + (31 - __builtin_clz(diff));
+            return a[i] < b[i] ? -1 : 1;
+        }
+    }
+    return compareAvx2(a, b, n);
+}
+
+#endif
+
+struct LimbKernels
+{
+    unsigned (*add)(unsigned *, const unsigned *, const unsigned *, size_t, unsigned);
+    unsigned (*sub)(unsigned *, const unsigned *, const unsigned *, size_t, unsigned);
+    unsigned (*mul)(unsigned *, const unsigned *, size_t, unsigned, unsigned);
+    int (*compare)(const unsigned *, const unsigned *, size_t);
+};
+
+static LimbKernels selectKernels()
+{
+    LimbKernels k = {addPortable, subPortable, mulPortable, comparePortable};
+#ifdef DISPATCH_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+    {
+        k.add = addAvx2;
+        k.sub = subAvx2;
+        k.compare = compareAvx2;
+        if(__builtin_cpu_supports("avx512f"))
+            k = {addAvx512, subAvx512, mulAvx512, compareAvx512};
+    }
+#endif
+    return k;
+}
+
+static inline const LimbKernels &kernels() noexcept
+{
+    return dispatched<LimbKernels, selectKernels>();
+}
+
+unsigned limbsAdd(unsigned *res, const unsigned *a, const unsigned *b, size_t n, unsigned carry) noexcept
+{
+    return kernels().add(res, a, b, n, carry);
+}
+
+unsigned limbsSub(unsigned *res, const unsigned *a, const unsigned *b, size_t n, unsigned borrow) noexcept
+{
+    return kernels().sub(res, a, b, n, borrow);
+}
+
+unsigned limbsMul(unsigned *res, const unsigned *a, size_t n, unsigned m, unsigned carry) noexcept
+{
+    return kernels().mul(res, a, n, m, carry);
+}
+
+int limbsCompare(const unsigned *a, const unsigned *b, size_t n) noexcept
+{
+    return kernels().compare(a, b, n);
+}
@@ -1,21 +1,32 @@
 #include "matrix.h"
 #include "parser.h"
 #include "finite.h"
+#include "wordfinite.h"
+#include "fixedfinite.h"
+#include "bitmatrix.h"
 #include "polynom.h"
 #include "complex.h"
+#include "threadpool.h"
 #include <map>
 #include <set>
 #include <sstream>
 #include <cstdlib>
+#include <climits>
 #include <algorithm>
+#include <thread>
 #include <readline/readline.h>
 #include <readline/history.h>
 
 using namespace std;
 
 BigInteger _FINITE_ORDER = 2;
+MontgomeryContext _FINITE_CONTEXT(_FINITE_ORDER);
+WordContext _WORD_CONTEXT(2);
 bool _is_complex = false;
 
+// MATRIX_THREADS above this many threads per core is capped
+const unsigned max_threads_per_core = 4;
+
 class end_of_input: public exception
 {
     using exception::exception;
@@ -265,19 +276,14 @@ struct _NumMatrix
 
 };
 
-Matrix<Finite> f_cfrac(Finite)
-{
-    die("cfrac is supported only for rationals");
-    return 0;
-}
-
-Matrix<Complex> f_cfrac(Complex)
+// cfrac, rcfrac and the decimal form only mean something for rationals, the other fields take these
+template<class Field>
+Matrix<Field> f_cfrac(Field)
 {
     die("cfrac is supported only for rationals");
     return 0;
 }
 
-
 Matrix<Rational> f_cfrac(Rational a)
 {
     std::vector<Rational> ans = {0};
@@ -303,6 +309,13 @@ Matrix<Rational> f_cfrac(Rational a)
 }
 
 
+template<class Field>
+Field f_revcfrac(const Matrix<Field> &)
+{
+    die("rcfrac is supported only for rationals");
+    return 0;
+}
+
 Rational f_revcfrac(const Matrix<Rational> &a)
 {
     Rational res = a[0][a.width() - 1];
@@ -313,21 +326,8 @@ Rational f_revcfrac(const Matrix<Rational> &a)
     return res;
 }
 
-Finite f_revcfrac(const Matrix<Finite> &)
-{
-    die("rcfrac is supported only for rationals");
-    return 0;
-}
-
-Complex f_revcfrac(const Matrix<Complex> &)
-{
-    die("rcfrac is supported only for rationals");
-    return 0;
-}
-
-void printDecimalResult(const Finite &) {}
-
-void printDecimalResult(const Complex &) {}
+template<class Field>
+void printDecimalResult(const Field &) {}
 
 void printDecimalResult(const Rational &a)
 {
@@ -349,15 +349,15 @@ Polynom<Field> gcd2(const Polynom<Field> &a, const Polynom<Field> &b)
 }
 
 
+// only the complex field has I predefined
+template<class Field>
+void _setI(map<char, _NumMatrix<Field>> &) {}
+
 void _setI(map<char, _NumMatrix<Complex>> &mmap)
 {
     mmap['I'] = Complex(0, 1);
 }
 
-void _setI(map<char, _NumMatrix<Rational>> &) {}
-
-void _setI(map<char, _NumMatrix<Finite>> &) {}
-
 template<class Field>
 void f_expr(string expr)
 {
@@ -463,13 +463,13 @@ void f_expr(string expr)
                         auto m = a[0]->toMatrix();
                         if(m.width() != 1 || m.height() != 1)
                             die("cfrac: matrix 1*1 required");
-                        return NumMatrix(f_cfrac(m[0][0]));
+                        return NumMatrix(f_cfrac(Field(m[0][0])));
                     }}},
                     {"pcfrac",   {1,  [](const vector<NumMatrix *> &a) {
                       auto m = a[0]->toMatrix();
                       if(m.width() != 1 || m.height() != 1)
                           die("pcfrac: matrix 1*1 required");
-                      auto cm = f_cfrac(m[0][0]);
+                      auto cm = f_cfrac(Field(m[0][0]));
                       for(size_t i = cm.width(); i; --i)
                           cm[0][i - 1] = f_revcfrac(cm.submatrix(0, 0, 0, i - 1));
                       return NumMatrix(cm);
@@ -819,12 +819,26 @@ void f_expr(string expr)
 }
 
 
+// MATRIX_THREADS=0 means one thread per core, the default
+unsigned parseThreadCount(const char *s)
+{
+    char *end;
+    long n = strtol(s, &end, 10);
+    if(end == s || *end || n < 0)
+        die("MATRIX_THREADS must be a non-negative integer");
+    unsigned limit = max_threads_per_core * max(1u, thread::hardware_concurrency());
+    return unsigned(min<long>(n, limit));
+}
+
 int main(int argc, char **argv)
 {
     try
     {
         string arg = (argc > 1 ? argv[1] : "");
         string expr;
+        // MATRIX_THREADS=1 keeps all the arithmetic on the main thread
+        if(const char *threads = getenv("MATRIX_THREADS"))
+            setThreadCount(parseThreadCount(threads));
         using_history();
         if(isdigit(arg))
         {
@@ -833,16 +847,75 @@ int main(int argc, char **argv)
                 die("Order must be at least 2");
             /*if(!_FINITE_ORDER.isPrime())
                 cout << "WARNING: finite field order is not prime\n";*/
-            do
+            if(_FINITE_ORDER == 2)
             {
-                try
+                do
                 {
-                    f_expr<Finite>(expr);
-                }
-                catch(invalid_expression &e)
+                    try
+                    {
+                        f_expr<Bit>(expr);
+                    }
+                    catch(invalid_expression &e)
+                    {
+                    }
+                } while(expr.empty());
+            }
+            // there is no flag for the presets: giving exactly 998244353 or 2^61 - 1 as the order picks NttFinite or
+            // MersenneFinite from fixedfinite.h, with the modulus built in
+            else if(_FINITE_ORDER == BigInteger(static_cast<long long>(NttFinite::ORDER)))
+            {
+                do
                 {
-                }
-            } while(expr.empty());
+                    try
+                    {
+                        f_expr<NttFinite>(expr);
+                    }
+                    catch(invalid_expression &e)
+                    {
+                    }
+                } while(expr.empty());
+            }
+            else if(_FINITE_ORDER == BigInteger(static_cast<long long>(MersenneFinite::ORDER)))
+            {
+                do
+                {
+                    try
+                    {
+                        f_expr<MersenneFinite>(expr);
+                    }
+                    catch(invalid_expression &e)
+                    {
+                    }
+                } while(expr.empty());
+            }
+            else if(_FINITE_ORDER <= LLONG_MAX)
+            {
+                _WORD_CONTEXT = WordContext(static_cast<unsigned long long>(static_cast<long long>(_FINITE_ORDER)));
+                do
+                {
+                    try
+                    {
+                        f_expr<WordFinite>(expr);
+                    }
+                    catch(invalid_expression &e)
+                    {
+                    }
+                } while(expr.empty());
+            }
+            else
+            {
+                _FINITE_CONTEXT = MontgomeryContext(_FINITE_ORDER);
+                do
+                {
+                    try
+                    {
+                        f_expr<Finite>(expr);
+                    }
+                    catch(invalid_expression &e)
+                    {
+                    }
+                } while(expr.empty());
+            }
         }
         else if(arg == "c" || arg == "C")
         {
@@ -881,5 +954,9 @@ int main(int argc, char **argv)
     {
         return 0;
     }
+    catch(invalid_expression &e)
+    {
+        return 1;
+    }
     return 0;
 }
@@ -1,9 +1,97 @@
 #include "matrix.h"
 #include "finite.h"
+#include "wordfinite.h"
+#include "fixedfinite.h"
 #include "complex.h"
+#include "accumulator.h"
+#include "packed.h"
 #include <sstream>
 
 const unsigned strassen_threshold = 32;
+// the packed product takes the right matrix in blocks of this many rows and columns to keep them in cache
+const unsigned packed_block_rows = 128;
+const unsigned packed_block_cols = 256;
+
+// the generic kernels hand their work to these first, and only WordFinite with an order below PACKED_ORDER takes it
+template<class Field>
+static bool packedProduct(const Matrix<Field> &, const Matrix<Field> &, Matrix<Field> &)
+{
+    return false;
+}
+
+template<class Field>
+static bool packedGauss(Matrix<Field> &, Matrix<Field> *, unsigned &)
+{
+    return false;
+}
+
+template<class Field>
+static bool packedBackSubstitution(Matrix<Field> &, Matrix<Field> &, const std::vector<Field> &)
+{
+    return false;
+}
+
+static bool packedProduct(const Matrix<WordFinite> &a, const Matrix<WordFinite> &b, Matrix<WordFinite> &res);
+
+static bool packedGauss(Matrix<WordFinite> &m, Matrix<WordFinite> *ext, unsigned &rank);
+
+static bool packedBackSubstitution(Matrix<WordFinite> &m, Matrix<WordFinite> &ext, const std::vector<WordFinite> &inv);
+
+// gauss for fields without unreduced sums, updating the entries in place
+template<class Field>
+static unsigned directGauss(Matrix<Field> &m, Matrix<Field> *ext)
+{
+    unsigned M = m.height(), N = m.width();
+    unsigned row = 0;
+    for(unsigned col = 0; col < N && row < M; ++col)
+    {
+        for(unsigned i = row; i < M; ++i)
+        {
+            if(m[i][col])
+            {
+                if(i != row)
+                {
+                    for(unsigned j = 0; j < N; ++j)
+                    {
+                        std::swap(m[i][j], m[row][j]);
+                        m[i][j] = -m[i][j];
+                    }
+                    if(ext)
+                    {
+                        for(unsigned j = 0; j < ext->width(); ++j)
+                        {
+                            std::swap((*ext)[i][j], (*ext)[row][j]);
+                            (*ext)[i][j] = -(*ext)[i][j];
+                        }
+                    }
+                }
+                break;
+            }
+        }
+        if(!m[row][col])
+        {
+            continue;
+        }
+        Field inv = Field(1) / m[row][col];
+        for(unsigned i = row + 1; i < M; ++i)
+        {
+            if(!m[i][col])
+                continue;
+            Field coeff = m[i][col] * inv;
+            for(unsigned j = 0; j < N; ++j)
+            {
+                submul(m[i][j], m[row][j], coeff);
+            }
+            if(ext)
+            {
+                for(unsigned j = 0; j < ext->width(); ++j)
+                    submul((*ext)[i][j], (*ext)[row][j], coeff);
+            }
+        }
+        ++row;
+    }
+    return row;
+}
 
 template<class Field>
 void Matrix<Field>::_strassen(unsigned N, Field *a, Field *b, Field *res)
@@ -14,10 +102,12 @@ void Matrix<Field>::_strassen(unsigned N, Field *a, Field *b, Field *res)
         {
             for(unsigned j = 0; j < N; ++j)
             {
+                Accumulator<Field> sum(res[i * N + j]);
                 for(unsigned q = 0; q < N; ++q)
                 {
-                    res[i * N + j] += a[i * N + q] * b[q * N + j];
+                    sum.add(a[i * N + q], b[q * N + j]);
                 }
+                res[i * N + j] = sum.value();
             }
         }
         return;
@@ -91,6 +181,11 @@ const Matrix<Field> Matrix<Field>::operator*(const Matrix &a) const
 {
     if(N != a.M)
         throw matrix_error("Trying to multiply matrices of different size");
+    Matrix res;
+    if(packedProduct(*this, a, res))
+    {
+        return res;
+    }
     if(std::max(M, a.N) < strassen_threshold)
     {
         return _multiplyCube(a);
@@ -110,10 +205,12 @@ Matrix<Field> Matrix<Field>::_multiplyCube(const Matrix &a) const
     {
         for(unsigned j = 0; j < a.N; ++j)
         {
+            Accumulator<Field> sum;
             for(unsigned q = 0; q < N; ++q)
             {
-                res[i][j] += (*this)[i][q] * a[q][j];
+                sum.add((*this)[i][q], a[q][j]);
             }
+            res[i][j] = sum.value();
         }
     }
     return res;
@@ -195,51 +292,64 @@ unsigned Matrix<Field>::gauss(Matrix *ext)
     {
         assert(M == ext->M);
     }
+    unsigned rk;
+    if(packedGauss(*this, ext, rk))
+        return rk;
+    if(!Accumulator<Field>::LAZY)
+        return directGauss(*this, ext);
+    // the rows below the pivot sum their updates unreduced; an entry is reduced when its column becomes the pivot
+    // column or its row the pivot row, and the rest at the end. ext is handled as extra columns
+    unsigned W = N + (ext ? ext->N : 0);
+    std::vector<Accumulator<Field>> lazy;
+    lazy.reserve(size_t(M) * W);
+    for(unsigned i = 0; i < M; ++i)
+    {
+        for(unsigned j = 0; j < N; ++j)
+            lazy.emplace_back((*this)[i][j]);
+        for(unsigned j = N; j < W; ++j)
+            lazy.emplace_back((*ext)[i][j - N]);
+    }
+    std::vector<Field> pivot_row(W);
     unsigned row = 0;
-    for(unsigned col = 0; col < N; ++col)
+    for(unsigned col = 0; col < N && row < M; ++col)
     {
-        for(unsigned i = row; i < M; ++i)
+        Field pivot;
+        unsigned i = row;
+        while(i < M && !(pivot = lazy[i * W + col].value()))
+            ++i;
+        if(i == M)
         {
-            if((*this)[i][col])
+            continue;
+        }
+        if(i != row)
+        {
+            for(unsigned j = 0; j < W; ++j)
             {
-                if(i != row)
-                {
-                    for(unsigned j = 0; j < N; ++j)
-                    {
-                        std::swap((*this)[i][j], (*this)[row][j]);
-                        (*this)[i][j] = -(*this)[i][j];
-                    }
-                    if(ext)
-                    {
-                        for(unsigned j = 0; j < ext->N; ++j)
-                        {
-                            std::swap((*ext)[i][j], (*ext)[row][j]);
-                            (*ext)[i][j] = -(*ext)[i][j];
-                        }
-                    }
-                }
-                break;
+                std::swap(lazy[i * W + j], lazy[row * W + j]);
+                lazy[i * W + j] = Accumulator<Field>(-lazy[i * W + j].value());
             }
         }
-        if(!(*this)[row][col])
+        for(unsigned j = 0; j < W; ++j)
         {
-            continue;
+            pivot_row[j] = lazy[row * W + j].value();
+            (j < N ? (*this)[row][j] : (*ext)[row][j - N]) = pivot_row[j];
         }
-        for(unsigned i = row + 1; i < M; ++i)
+        Field inv = Field(1) / pivot;
+        for(i = row + 1; i < M; ++i)
         {
-            Field coeff = (*this)[i][col] / (*this)[row][col];
-            for(unsigned j = 0; j < N; ++j)
-            {
-                (*this)[i][j] -= (*this)[row][j] * coeff;
-            }
-            if(ext)
-            {
-                for(unsigned j = 0; j < ext->N; ++j)
-                    (*ext)[i][j] -= (*ext)[row][j] * coeff;
-            }
+            Field coeff = lazy[i * W + col].value();
+            if(!coeff)
+                continue;
+            coeff *= inv;
+            for(unsigned j = 0; j < W; ++j)
+                lazy[i * W + j].sub(pivot_row[j], coeff);
         }
-        if(++row == M)
-            return row;
+        ++row;
+    }
+    for(unsigned i = row; i < M; ++i)
+    {
+        for(unsigned j = 0; j < W; ++j)
+            (j < N ? (*this)[i][j] : (*ext)[i][j - N]) = lazy[i * W + j].value();
     }
     return row;
 }
@@ -393,9 +503,16 @@ void Matrix<Field>::inverseExt(Matrix &ext)
     {
         throw matrix_error("Cannot inverse a singular matrix");
     }
+    // the back substitution scales each row once and never touches the other diagonal elements
+    std::vector<Field> inv(N);
+    for(unsigned i = 0; i < N; ++i)
+        inv[i] = (*this)[i][i];
+    invertAll(inv);
+    if(packedBackSubstitution(*this, ext, inv))
+        return;
     for(unsigned i = N - 1; i != unsigned(-1); --i)
     {
-        Field coeff = Field(1) / (*this)[i][i];
+        const Field &coeff = inv[i];
         for(unsigned j = 0; j < N; ++j)
         {
             (*this)[i][j] *= coeff;
@@ -410,7 +527,7 @@ void Matrix<Field>::inverseExt(Matrix &ext)
                 continue;
             for(unsigned q = 0; q < ext.N; q++)
             {
-                ext[i][q] -= ext[j][q] * (*this)[i][j];
+                submul(ext[i][q], ext[j][q], (*this)[i][j]);
             }
             (*this)[i][j] = Field();
         }
@@ -438,11 +555,18 @@ const Matrix<Field> Matrix<Field>::fundamental() const
             }
         }
     }
+    std::vector<Field> pivots;
     for(unsigned i = 0; i < N; ++i)
+    {
+        if(dependent[i])
+            pivots.push_back(m[dep_height[i]][i]);
+    }
+    invertAll(pivots);
+    for(unsigned i = 0, k = 0; i < N; ++i)
     {
         if(!dependent[i])
             continue;
-        Field inv = Field(1) / m[dep_height[i]][i];
+        Field inv = pivots[k++];
         for(unsigned j = i; j < N; ++j)
         {
             m[dep_height[i]][j] *= inv;
@@ -453,7 +577,7 @@ const Matrix<Field> Matrix<Field>::fundamental() const
                 continue;
             for(unsigned q = i + 1; q < N; ++q)
             {
-                m[j][q] -= m[j][i] * m[dep_height[i]][q];
+                submul(m[j][q], m[j][i], m[dep_height[i]][q]);
             }
             m[j][i] = 0;
         }
@@ -511,7 +635,7 @@ const Matrix<Field> Matrix<Field>::partial() const
         ans[0][col] = cval;
         for(int i = 0; i <= row; ++i)
         {
-            right[i][0] -= cval * sys[i][col];
+            submul(right[i][0], cval, sys[i][col]);
         }
     }
     return ans;
@@ -615,11 +739,14 @@ const Matrix<Field> Matrix<Field>::charPolynom() const
 template<class T>
 std::pair<BigInteger, BigInteger> posDivmod(const T &a, const T &b)
 {
-    BigInteger aa(a), bb(b);
-    BigInteger div = aa / bb;
-    if(div * bb > aa)
-        --div;
-    return {div, aa - div * bb};
+    BigInteger bb(b);
+    auto res = divmod(BigInteger(a), bb);
+    if(res.second < 0)
+    {
+        --res.first;
+        res.second += bb;
+    }
+    return res;
 }
 
 template<class Field>
@@ -797,8 +924,232 @@ void Matrix<Field>::_read_from_istream(std::istream &in)
     }
 }
 
+// Montgomery's trick: one inversion and three multiplications per element. A non-unit modulo a composite order would
+// spoil the whole batch, so then every element is inverted on its own
+template<class Field>
+static void batchInverse(std::vector<Field> &a)
+{
+    if(a.empty())
+        return;
+    std::vector<Field> prefix(a.size());
+    prefix[0] = a[0];
+    for(size_t i = 1; i < a.size(); ++i)
+        prefix[i] = prefix[i - 1] * a[i];
+    Field inv = (prefix.back() ? Field(1) / prefix.back() : Field());
+    if(inv * prefix.back() != Field(1))
+    {
+        for(Field &x : a)
+            x = Field(1) / x;
+        return;
+    }
+    for(size_t i = a.size() - 1; i > 0; --i)
+    {
+        Field t = inv * prefix[i - 1];
+        inv *= a[i];
+        a[i] = t;
+    }
+    a[0] = inv;
+}
+
+// products of two residues below p that a double holds exactly on top of a value below p
+static size_t packedTerms(double p)
+{
+    return size_t((9007199254740992.0 - p) / ((p - 1) * (p - 1)));
+}
+
+// the left matrix in the form times the right one in plain residues gives the product in the form; the sums go
+// unreduced for as many terms as packedTerms allows
+static bool packedProduct(const Matrix<WordFinite> &a, const Matrix<WordFinite> &b, Matrix<WordFinite> &res)
+{
+    if(!_WORD_CONTEXT.packed())
+        return false;
+    unsigned M = a.height(), K = a.width(), P = b.width();
+    double p = double(_WORD_CONTEXT.modulus());
+    std::vector<double> x(size_t(M) * K), y(size_t(K) * P), z(size_t(M) * P);
+    for(unsigned i = 0; i < M; ++i)
+        for(unsigned q = 0; q < K; ++q)
+            x[size_t(i) * K + q] = a[i][q].packed();
+    for(unsigned q = 0; q < K; ++q)
+        for(unsigned j = 0; j < P; ++j)
+            y[size_t(q) * P + j] = int(b[q][j]);
+    size_t terms = packedTerms(p), step = std::min<size_t>(packed_block_rows, terms);
+    for(unsigned j0 = 0; j0 < P; j0 += packed_block_cols)
+    {
+        unsigned len = std::min(packed_block_cols, P - j0);
+        size_t pending = 0;
+        for(unsigned q0 = 0; q0 < K; q0 += step)
+        {
+            unsigned q1 = unsigned(std::min<size_t>(K, q0 + step));
+            if(pending + (q1 - q0) > terms)
+            {
+                for(unsigned i = 0; i < M; ++i)
+                    packedReduce(&z[size_t(i) * P + j0], len, p);
+                pending = 0;
+            }
+            for(unsigned i = 0; i < M; ++i)
+                packedAxpyRows(&z[size_t(i) * P + j0], &y[size_t(q0) * P + j0], P, &x[size_t(i) * K + q0], q1 - q0, len);
+            pending += q1 - q0;
+        }
+    }
+    packedReduce(z.data(), z.size(), p);
+    res = Matrix<WordFinite>(M, P);
+    for(unsigned i = 0; i < M; ++i)
+        for(unsigned j = 0; j < P; ++j)
+            res[i][j] = WordFinite::fromPacked(z[size_t(i) * P + j]);
+    return true;
+}
+
+// the same steps as the generic gauss on rows of doubles. The pivot row is reduced, the rows below only in the pivot
+// column, and all of them once packedTerms updates have piled up
+static bool packedGauss(Matrix<WordFinite> &m, Matrix<WordFinite> *ext, unsigned &rank)
+{
+    if(!_WORD_CONTEXT.packed())
+        return false;
+    unsigned M = m.height(), N = m.width(), W = N + (ext ? ext->width() : 0);
+    double p = double(_WORD_CONTEXT.modulus());
+    size_t terms = packedTerms(p), pending = 0;
+    std::vector<double> a(size_t(M) * W);
+    for(unsigned i = 0; i < M; ++i)
+    {
+        for(unsigned j = 0; j < N; ++j)
+            a[size_t(i) * W + j] = m[i][j].packed();
+        for(unsigned j = N; j < W; ++j)
+            a[size_t(i) * W + j] = (*ext)[i][j - N].packed();
+    }
+    unsigned row = 0;
+    bool units = true;
+    for(unsigned col = 0; col < N && row < M; ++col)
+    {
+        unsigned i = row;
+        for(; i < M; ++i)
+        {
+            packedReduce(&a[size_t(i) * W + col], 1, p);
+            if(a[size_t(i) * W + col])
+                break;
+        }
+        if(i == M)
+        {
+            continue;
+        }
+        double *pivot_row = &a[size_t(row) * W];
+        if(i != row)
+        {
+            std::swap_ranges(pivot_row, pivot_row + W, &a[size_t(i) * W]);
+            for(unsigned j = 0; j < W; ++j)
+                a[size_t(i) * W + j] = -a[size_t(i) * W + j];
+        }
+        packedReduce(pivot_row, W, p);
+        if(pending == terms)
+        {
+            packedReduce(pivot_row + W, size_t(M - row - 1) * W, p);
+            pending = 0;
+        }
+        WordFinite pivot = WordFinite::fromPacked(pivot_row[col]), inv = WordFinite(1) / pivot;
+        // while every pivot is a unit the rows below are zero left of the pivot column
+        unsigned from = (units ? col : 0);
+        units = units && inv * pivot == WordFinite(1);
+        for(i = row + 1; i < M; ++i)
+        {
+            double &x = a[size_t(i) * W + col];
+            packedReduce(&x, 1, p);
+            if(!x)
+                continue;
+            WordFinite coeff = WordFinite::fromPacked(x) * inv;
+            packedAxpy(&a[size_t(i) * W + from], pivot_row + from, W - from, -double(int(coeff)));
+        }
+        ++pending;
+        ++row;
+    }
+    packedReduce(a.data(), a.size(), p);
+    for(unsigned i = 0; i < M; ++i)
+    {
+        for(unsigned j = 0; j < N; ++j)
+            m[i][j] = WordFinite::fromPacked(a[size_t(i) * W + j]);
+        for(unsigned j = N; j < W; ++j)
+            (*ext)[i][j - N] = WordFinite::fromPacked(a[size_t(i) * W + j]);
+    }
+    rank = row;
+    return true;
+}
+
+static bool packedBackSubstitution(Matrix<WordFinite> &m, Matrix<WordFinite> &ext, const std::vector<WordFinite> &inv)
+{
+    if(!_WORD_CONTEXT.packed())
+        return false;
+    unsigned N = m.width(), E = ext.width();
+    double p = double(_WORD_CONTEXT.modulus());
+    size_t terms = packedTerms(p);
+    std::vector<double> e(size_t(N) * E);
+    for(unsigned i = 0; i < N; ++i)
+        for(unsigned j = 0; j < E; ++j)
+            e[size_t(i) * E + j] = ext[i][j].packed();
+    for(unsigned i = N - 1; i != unsigned(-1); --i)
+    {
+        const WordFinite &coeff = inv[i];
+        for(unsigned j = 0; j < N; ++j)
+        {
+            m[i][j] *= coeff;
+        }
+        double *row = &e[size_t(i) * E];
+        packedScale(row, E, int(coeff), p);
+        size_t pending = 0;
+        for(unsigned j = i + 1; j < N; j++)
+        {
+            if(!m[i][j])
+                continue;
+            if(pending == terms)
+            {
+                packedReduce(row, E, p);
+                pending = 0;
+            }
+            packedAxpy(row, &e[size_t(j) * E], E, -double(int(m[i][j])));
+            ++pending;
+            m[i][j] = WordFinite();
+        }
+        packedReduce(row, E, p);
+    }
+    for(unsigned i = 0; i < N; ++i)
+        for(unsigned j = 0; j < E; ++j)
+            ext[i][j] = WordFinite::fromPacked(e[size_t(i) * E + j]);
+    return true;
+}
+
+void invertAll(std::vector<Finite> &a)
+{
+    batchInverse(a);
+}
+
+void invertAll(std::vector<WordFinite> &a)
+{
+    batchInverse(a);
+}
+
+template<unsigned long long P>
+void invertAll(std::vector<FixedFinite<P>> &a)
+{
+    batchInverse(a);
+}
+
+// inverting a fraction only swaps its parts, cheaper than the products of a batch
+void invertAll(std::vector<Rational> &a)
+{
+    for(Rational &x : a)
+        x = 1 / x;
+}
+
+void invertAll(std::vector<Complex> &a)
+{
+    for(Complex &x : a)
+        x = Complex(1) / x;
+}
+
 void makeIntColumns(Matrix<Finite> &) {}
 
+void makeIntColumns(Matrix<WordFinite> &) {}
+
+template<unsigned long long P>
+void makeIntColumns(Matrix<FixedFinite<P>> &) {}
+
 void makeIntColumns(Matrix<Rational> &m)
 {
     for(unsigned col = 0; col < m.width(); ++col)
@@ -808,7 +1159,7 @@ void makeIntColumns(Matrix<Rational> &m)
         for(unsigned i = 0; i < m.height(); ++i)
         {
             if(m[i][col].denominator() != 1)
-                g *= m[i][col].denominator() / gcd(g, m[i][col].denominator());
+                g *= divexact(m[i][col].denominator(), gcd(g, m[i][col].denominator()));
             pos += m[i][col] > 0;
             neg += m[i][col] < 0;
         }
@@ -831,7 +1182,7 @@ void makeIntColumns(Matrix<Complex> &m)
         {
             if(m[i][col].re().denominator() != 1 || m[i][col].im().denominator() != 1)
             {
-                g *= m[i][col].denominator() / gcd(g, m[i][col].denominator());
+                g *= divexact(m[i][col].denominator(), gcd(g, m[i][col].denominator()));
             }
             pos += m[i][col] > 0;
             neg += m[i][col] < 0;
@@ -852,5 +1203,14 @@ class Matrix<Rational>;
 template
 class Matrix<Finite>;
 
+template
+class Matrix<WordFinite>;
+
+template
+class Matrix<NttFinite>;
+
+template
+class Matrix<MersenneFinite>;
+
 template
 class Matrix<Complex>;
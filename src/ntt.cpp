@@ -0,0 +1,197 @@
+#include "ntt.h"
+#include "threadpool.h"
+#include <vector>
+#include <algorithm>
+
+// a prime of the form c * 2^k + 1 below 2^31 with primitive root G, supports transforms of length up to 2^k;
+// twiddle factors are kept in Montgomery form so that every butterfly costs a single Montgomery reduction
+template<unsigned P, unsigned G>
+class NttPrime
+{
+    static const unsigned NEG_INV;
+    static const unsigned R2;
+
+    static unsigned negInverse() noexcept
+    {
+        unsigned inv = P;
+        for(int i = 0; i < 5; ++i)
+            inv *= 2 - P * inv;
+        return 0u - inv;
+    }
+
+    static unsigned reduce(unsigned long long t) noexcept
+    {
+        unsigned m = static_cast<unsigned>(t) * NEG_INV;
+        unsigned u = static_cast<unsigned>((t + m * 1ull * P) >> 32);
+        return u - (P & (0u - (u >= P)));
+    }
+
+    static unsigned montMul(unsigned a, unsigned b) noexcept
+    {
+        return reduce(a * 1ull * b);
+    }
+
+    static unsigned toMont(unsigned a) noexcept
+    {
+        return montMul(a, R2);
+    }
+
+    // branch-free on purpose, the transform data is random and mispredictions dominate otherwise
+    static unsigned add(unsigned a, unsigned b) noexcept
+    {
+        unsigned s = a + b;
+        return s - (P & (0u - (s >= P)));
+    }
+
+    static unsigned sub(unsigned a, unsigned b) noexcept
+    {
+        return a - b + (P & (0u - (a < b)));
+    }
+
+    // decimation in frequency, natural order in, bit-reversed order out
+    static void forward(std::vector<unsigned> &a, const std::vector<unsigned> &roots) noexcept
+    {
+        size_t n = a.size();
+        for(size_t half = n / 2; half; half >>= 1)
+        {
+            const unsigned *w = roots.data() + half;
+            for(size_t i = 0; i < n; i += 2 * half)
+            {
+                unsigned *x = a.data() + i, *y = x + half;
+                for(size_t j = 0; j < half; ++j)
+                {
+                    unsigned u = x[j], v = y[j];
+                    x[j] = add(u, v);
+                    y[j] = montMul(sub(u, v), w[j]);
+                }
+            }
+        }
+    }
+
+    // decimation in time, bit-reversed order in, natural order out
+    static void backward(std::vector<unsigned> &a, const std::vector<unsigned> &roots) noexcept
+    {
+        size_t n = a.size();
+        for(size_t half = 1; half < n; half <<= 1)
+        {
+            const unsigned *w = roots.data() + half;
+            for(size_t i = 0; i < n; i += 2 * half)
+            {
+                unsigned *x = a.data() + i, *y = x + half;
+                for(size_t j = 0; j < half; ++j)
+                {
+                    unsigned u = x[j], v = montMul(y[j], w[j]);
+                    x[j] = add(u, v);
+                    y[j] = sub(u, v);
+                }
+            }
+        }
+    }
+
+    // roots[half + j] = w^j for a primitive (2 * half)-th root of unity w, in Montgomery form
+    static const std::vector<unsigned> makeRoots(size_t n, bool invert)
+    {
+        std::vector<unsigned> roots(std::max<size_t>(n, 2));
+        unsigned w = power(G, (P - 1) / n);
+        if(invert)
+            w = power(w, P - 2);
+        w = toMont(w);
+        size_t half = std::max<size_t>(n / 2, 1);
+        roots[half] = toMont(1);
+        for(size_t j = 1; j < half; ++j)
+            roots[half + j] = montMul(roots[half + j - 1], w);
+        for(half /= 2; half; half /= 2)
+            for(size_t j = 0; j < half; ++j)
+                roots[half + j] = roots[2 * half + 2 * j];
+        return roots;
+    }
+
+public:
+    static unsigned mul(unsigned a, unsigned b) noexcept
+    {
+        return static_cast<unsigned>(a * 1ull * b % P);
+    }
+
+    static unsigned power(unsigned a, unsigned long long e) noexcept
+    {
+        unsigned res = 1;
+        for(; e; e >>= 1)
+        {
+            if(e & 1)
+                res = mul(res, a);
+            a = mul(a, a);
+        }
+        return res;
+    }
+
+    static const std::vector<unsigned> convolve(const unsigned *a, size_t na, const unsigned *b, size_t nb, size_t len)
+    {
+        // a square needs only one forward transform
+        bool sqr = (a == b && na == nb);
+        std::vector<unsigned> fa(len), fb(sqr ? 0 : len);
+        for(size_t i = 0; i < na; ++i)
+            fa[i] = a[i] % P;
+        std::vector<unsigned> roots = makeRoots(len, false);
+        if(sqr)
+            forward(fa, roots);
+        else
+            parallelRun({[&] { forward(fa, roots); }, [&]
+            {
+                for(size_t i = 0; i < nb; ++i)
+                    fb[i] = b[i] % P;
+                forward(fb, roots);
+            }});
+        const std::vector<unsigned> &fc = (sqr ? fa : fb);
+        // the pointwise product drops a factor of R, the final scaling by R^2 / len puts it back
+        for(size_t i = 0; i < len; ++i)
+            fa[i] = montMul(fa[i], fc[i]);
+        backward(fa, makeRoots(len, true));
+        unsigned scale = mul(power(static_cast<unsigned>(len % P), P - 2), R2);
+        for(unsigned &x : fa)
+            x = montMul(x, scale);
+        return fa;
+    }
+};
+
+template<unsigned P, unsigned G>
+const unsigned NttPrime<P, G>::NEG_INV = NttPrime<P, G>::negInverse();
+
+template<unsigned P, unsigned G>
+const unsigned NttPrime<P, G>::R2 = static_cast<unsigned>((1ull << 32) % P * ((1ull << 32) % P) % P);
+
+typedef NttPrime<2013265921, 31> NttPrime1;
+typedef NttPrime<469762049, 3> NttPrime2;
+typedef NttPrime<754974721, 11> NttPrime3;
+
+// convolves the limbs modulo three primes and restores the exact sums (below 2^89) with Garner's CRT;
+// the three convolutions and the two forward transforms of each run as parallel tasks
+void nttMultiply(const unsigned *a, size_t na, const unsigned *b, size_t nb, unsigned *res)
+{
+    const unsigned P1 = 2013265921, P2 = 469762049, P3 = 754974721;
+    const unsigned long long P1P2 = P1 * 1ull * P2, LOW = 0xffffffffull;
+    static const unsigned p1_inv = NttPrime2::power(P1 % P2, P2 - 2);
+    static const unsigned p1p2_inv = NttPrime3::power(P1P2 % P3, P3 - 2);
+    size_t len = 1;
+    while(len < na + nb - 1)
+        len <<= 1;
+    std::vector<unsigned> r1, r2, r3;
+    parallelRun({[&] { r1 = NttPrime1::convolve(a, na, b, nb, len); },
+                 [&] { r2 = NttPrime2::convolve(a, na, b, nb, len); },
+                 [&] { r3 = NttPrime3::convolve(a, na, b, nb, len); }});
+    unsigned long long carry = 0;
+    for(size_t i = 0; i < na + nb; ++i)
+    {
+        unsigned long long x = 0, y_low = 0, y_high = 0;
+        if(i < na + nb - 1)
+        {
+            unsigned t2 = NttPrime2::mul((r2[i] + P2 - r1[i] % P2) % P2, p1_inv);
+            x = r1[i] + P1 * 1ull * t2;
+            unsigned t3 = NttPrime3::mul(static_cast<unsigned>((r3[i] + P3 - x % P3) % P3), p1p2_inv);
+            y_low = (P1P2 & LOW) * t3;
+            y_high = (P1P2 >> 32) * t3;
+        }
+        unsigned long long low = (carry & LOW) + (x & LOW) + (y_low & LOW);
+        res[i] = static_cast<unsigned>(low);
+        carry = (low >> 32) + (carry >> 32) + (x >> 32) + (y_low >> 32) + y_high;
+    }
+}
@@ -0,0 +1,157 @@
+#include "packed.h"
+#include "dispatch.h"
+#include <cmath>
+
+static void axpyPortable(double *res, const double *a, size_t n, double c) noexcept
+{
+    for(size_t i = 0; i < n; ++i)
+        res[i] += c * a[i];
+}
+
+static void axpyRowsPortable(double *res, const double *a, size_t stride, const double *c, size_t count,
+                             size_t n) noexcept
+{
+    for(size_t k = 0; k < count; ++k)
+        axpyPortable(res, a + k * stride, n, c[k]);
+}
+
+// the quotient from the rounded reciprocal is off by at most one, which leaves the remainder in [-p, 2p)
+static void reducePortable(double *res, size_t n, double p) noexcept
+{
+    double inv = 1 / p;
+    for(size_t i = 0; i < n; ++i)
+    {
+        double x = res[i] - std::floor(res[i] * inv) * p;
+        if(x < 0)
+            x += p;
+        else if(x >= p)
+            x -= p;
+        res[i] = x;
+    }
+}
+
+static void scalePortable(double *res, size_t n, double c, double p) noexcept
+{
+    for(size_t i = 0; i < n; ++i)
+        res[i] *= c;
+    reducePortable(res, n, p);
+}
+
+#ifdef DISPATCH_X86
+
+__attribute__((target("avx2,fma")))
+static void axpyAvx2(double *res, const double *a, size_t n, double c) noexcept
+{
+    const __m256d vc = _mm256_set1_pd(c);
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8)
+    {
+        __m256d x = _mm256_loadu_pd(res + i), y = _mm256_loadu_pd(res + i + 4);
+        x = _mm256_fmadd_pd(vc, _mm256_loadu_pd(a + i), x);
+        y = _mm256_fmadd_pd(vc, _mm256_loadu_pd(a + i + 4), y);
+        _mm256_storeu_pd(res + i, x);
+        _mm256_storeu_pd(res + i + 4, y);
+    }
+    axpyPortable(res + i, a + i, n - i, c);
+}
+
+// sixteen sums stay in registers while all the rows are added to them
+__attribute__((target("avx2,fma")))
+static void axpyRowsAvx2(double *res, const double *a, size_t stride, const double *c, size_t count, size_t n) noexcept
+{
+    size_t j = 0;
+    for(; j + 16 <= n; j += 16)
+    {
+        __m256d x0 = _mm256_loadu_pd(res + j), x1 = _mm256_loadu_pd(res + j + 4);
+        __m256d x2 = _mm256_loadu_pd(res + j + 8), x3 = _mm256_loadu_pd(res + j + 12);
+        const double *row = a + j;
+        for(size_t k = 0; k < count; ++k, row += stride)
+        {
+            __m256d vc = _mm256_broadcast_sd(c + k);
+            x0 = _mm256_fmadd_pd(vc, _mm256_loadu_pd(row), x0);
+            x1 = _mm256_fmadd_pd(vc, _mm256_loadu_pd(row + 4), x1);
+            x2 = _mm256_fmadd_pd(vc, _mm256_loadu_pd(row + 8), x2);
+            x3 = _mm256_fmadd_pd(vc, _mm256_loadu_pd(row + 12), x3);
+        }
+        _mm256_storeu_pd(res + j, x0);
+        _mm256_storeu_pd(res + j + 4, x1);
+        _mm256_storeu_pd(res + j + 8, x2);
+        _mm256_storeu_pd(res + j + 12, x3);
+    }
+    axpyRowsPortable(res + j, a + j, stride, c, count, n - j);
+}
+
+__attribute__((target("avx2,fma")))
+static inline __m256d reduceLanes(__m256d x, __m256d vp, __m256d inv) noexcept
+{
+    x = _mm256_fnmadd_pd(_mm256_floor_pd(_mm256_mul_pd(x, inv)), vp, x);
+    x = _mm256_add_pd(x, _mm256_and_pd(_mm256_cmp_pd(x, _mm256_setzero_pd(), _CMP_LT_OQ), vp));
+    return _mm256_sub_pd(x, _mm256_and_pd(_mm256_cmp_pd(x, vp, _CMP_GE_OQ), vp));
+}
+
+__attribute__((target("avx2,fma")))
+static void reduceAvx2(double *res, size_t n, double p) noexcept
+{
+    const __m256d vp = _mm256_set1_pd(p), inv = _mm256_set1_pd(1 / p);
+    size_t i = 0;
+    for(; i + 4 <= n; i += 4)
+        _mm256_storeu_pd(res + i, reduceLanes(_mm256_loadu_pd(res + i), vp, inv));
+    reducePortable(res + i, n - i, p);
+}
+
+__attribute__((target("avx2,fma")))
+static void scaleAvx2(double *res, size_t n, double c, double p) noexcept
+{
+    const __m256d vp = _mm256_set1_pd(p), inv = _mm256_set1_pd(1 / p), vc = _mm256_set1_pd(c);
+    size_t i = 0;
+    for(; i + 4 <= n; i += 4)
+        _mm256_storeu_pd(res + i, reduceLanes(_mm256_mul_pd(_mm256_loadu_pd(res + i), vc), vp, inv));
+    scalePortable(res + i, n - i, c, p);
+}
+
+#endif
+
+struct PackedKernels
+{
+    void (*axpy)(double *, const double *, size_t, double);
+    void (*axpyRows)(double *, const double *, size_t, const double *, size_t, size_t);
+    void (*reduce)(double *, size_t, double);
+    void (*scale)(double *, size_t, double, double);
+};
+
+static PackedKernels selectKernels()
+{
+    PackedKernels k = {axpyPortable, axpyRowsPortable, reducePortable, scalePortable};
+#ifdef DISPATCH_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        k = {axpyAvx2, axpyRowsAvx2, reduceAvx2, scaleAvx2};
+#endif
+    return k;
+}
+
+static inline const PackedKernels &kernels() noexcept
+{
+    return dispatched<PackedKernels, selectKernels>();
+}
+
+void packedAxpy(double *res, const double *a, size_t n, double c) noexcept
+{
+    kernels().axpy(res, a, n, c);
+}
+
+void packedAxpyRows(double *res, const double *a, size_t stride, const double *c, size_t count, size_t n) noexcept
+{
+    kernels().axpyRows(res, a, stride, c, count, n);
+}
+
+void packedReduce(double *res, size_t n, double p) noexcept
+{
+    kernels().reduce(res, n, p);
+}
+
+void packedScale(double *res, size_t n, double c, double p) noexcept
+{
+    kernels().scale(res, n, c, p);
+}
+
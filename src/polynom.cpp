@@ -1,5 +1,8 @@
 #include "polynom.h"
 #include "finite.h"
+#include "wordfinite.h"
+#include "fixedfinite.h"
+#include "bitmatrix.h"
 #include "complex.h"
 
 template<class Field>
@@ -109,11 +112,27 @@ template<class Field>
 const Polynom<Field> Polynom<Field>::operator*(const Polynom &a) const
 {
     Polynom temp(m.width() + a.m.width() - 1);
+    if(&a == this)
+    {
+        // a square needs each cross product only once
+        for(unsigned i = 0; i < m.width(); ++i)
+        {
+            const Field &c = m[0][m.width() - 1 - i];
+            temp.m[0][temp.m.width() - 1 - 2 * i] += c * c;
+            for(unsigned j = i + 1; j < m.width(); ++j)
+            {
+                Field p = c * m[0][m.width() - 1 - j];
+                temp.m[0][temp.m.width() - 1 - i - j] += p + p;
+            }
+        }
+        temp.strip();
+        return temp;
+    }
     for(unsigned i = 0; i < m.width(); ++i)
     {
         for(unsigned j = 0; j < a.m.width(); ++j)
         {
-            temp.m[0][temp.m.width() - 1 - i - j] += m[0][m.width() - 1 - i] * a.m[0][a.m.width() - 1 - j];
+            addmul(temp.m[0][temp.m.width() - 1 - i - j], m[0][m.width() - 1 - i], a.m[0][a.m.width() - 1 - j]);
         }
     }
     temp.strip();
@@ -347,6 +366,22 @@ Finite _denominator(const Finite &)
     return 1;
 }
 
+WordFinite _denominator(const WordFinite &)
+{
+    return 1;
+}
+
+template<unsigned long long P>
+FixedFinite<P> _denominator(const FixedFinite<P> &)
+{
+    return 1;
+}
+
+Bit _denominator(const Bit &)
+{
+    return 1;
+}
+
 Rational _denominator(const Rational &a)
 {
     return a.denominator();
@@ -461,5 +496,17 @@ class Polynom<Rational>;
 template
 class Polynom<Finite>;
 
+template
+class Polynom<WordFinite>;
+
+template
+class Polynom<NttFinite>;
+
+template
+class Polynom<MersenneFinite>;
+
+template
+class Polynom<Bit>;
+
 template
 class Polynom<Complex>;
@@ -8,8 +8,10 @@ void Rational::normalize()
         _numerator = -_numerator;
     }
     BigInteger a = gcd(abs(_numerator), _denominator);
-    _numerator /= a;
-    _denominator /= a;
+    if(a == 1)
+        return;
+    _numerator._divexact(a);
+    _denominator._divexact(a);
 }
 
 void Rational::expand(const BigInteger &a)
@@ -62,14 +64,22 @@ std::string Rational::toString() const
 Rational &Rational::operator+=(const Rational &a)
 {
     BigInteger d = gcd(_denominator, a._denominator);
-    expand(a._denominator / d);
-    _numerator += a._numerator * _denominator / a._denominator;
+    BigInteger k = divexact(_denominator, d);
+    expand(divexact(a._denominator, d));
+    addmul(_numerator, a._numerator, k);
     normalize();
     return *this;
 }
 
 Rational &Rational::operator*=(const Rational &a)
 {
+    // the square of a reduced fraction is reduced
+    if(&a == this)
+    {
+        _numerator = _numerator.square();
+        _denominator = _denominator.square();
+        return *this;
+    }
     _numerator *= a._numerator;
     _denominator *= a._denominator;
     if(_denominator != 1)
@@ -110,6 +120,22 @@ const std::string Rational::asDecimal(size_t precision) const
 }
 
 
+void addmul(Rational &acc, const Rational &x, const Rational &y)
+{
+    if(acc._denominator == 1 && x._denominator == 1 && y._denominator == 1)
+        addmul(acc._numerator, x._numerator, y._numerator);
+    else
+        acc += x * y;
+}
+
+void submul(Rational &acc, const Rational &x, const Rational &y)
+{
+    if(acc._denominator == 1 && x._denominator == 1 && y._denominator == 1)
+        submul(acc._numerator, x._numerator, y._numerator);
+    else
+        acc -= x * y;
+}
+
 const Rational operator+(const Rational &a, const Rational &b)
 {
     Rational temp(a);
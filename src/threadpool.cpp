@@ -0,0 +1,142 @@
+#include "threadpool.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+class ThreadPool
+{
+    struct Group
+    {
+        size_t remaining;
+        std::condition_variable done;
+
+        explicit Group(size_t n): remaining(n), done() {}
+    };
+
+    struct Job
+    {
+        const std::function<void()> *task;
+        Group *group;
+    };
+
+    std::vector<std::thread> workers;
+    std::deque<Job> queue;
+    std::mutex lock;
+    std::condition_variable wake;
+    bool stopping;
+
+    // called with the lock held, releases it while the task runs
+    void runJob(std::unique_lock<std::mutex> &l)
+    {
+        Job job = queue.front();
+        queue.pop_front();
+        l.unlock();
+        (*job.task)();
+        l.lock();
+        if(!--job.group->remaining)
+            job.group->done.notify_all();
+    }
+
+    void work()
+    {
+        std::unique_lock<std::mutex> l(lock);
+        while(true)
+        {
+            wake.wait(l, [this] { return stopping || !queue.empty(); });
+            if(queue.empty())
+                return;
+            runJob(l);
+        }
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> l(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for(std::thread &t : workers)
+            t.join();
+        workers.clear();
+        stopping = false;
+    }
+
+public:
+    ThreadPool(): workers(), queue(), lock(), wake(), stopping(false)
+    {
+        resize(0);
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    ~ThreadPool()
+    {
+        stop();
+    }
+
+    void resize(unsigned n)
+    {
+        if(!n)
+            n = std::max(1u, std::thread::hardware_concurrency());
+        stop();
+        for(unsigned i = 1; i < n; ++i)
+            workers.emplace_back(&ThreadPool::work, this);
+    }
+
+    unsigned size() const
+    {
+        return static_cast<unsigned>(workers.size()) + 1;
+    }
+
+    void run(const std::vector<std::function<void()>> &tasks)
+    {
+        if(workers.empty() || tasks.size() < 2)
+        {
+            for(const std::function<void()> &t : tasks)
+                t();
+            return;
+        }
+        Group group(tasks.size() - 1);
+        {
+            std::lock_guard<std::mutex> l(lock);
+            for(size_t i = 1; i < tasks.size(); ++i)
+                queue.push_back({&tasks[i], &group});
+        }
+        wake.notify_all();
+        tasks[0]();
+        std::unique_lock<std::mutex> l(lock);
+        while(group.remaining)
+        {
+            if(!queue.empty())
+                runJob(l);
+            else
+                group.done.wait(l);
+        }
+    }
+};
+
+static ThreadPool &pool()
+{
+    static ThreadPool instance;
+    return instance;
+}
+
+void setThreadCount(unsigned n)
+{
+    pool().resize(n);
+}
+
+unsigned threadCount()
+{
+    return pool().size();
+}
+
+void parallelRun(const std::vector<std::function<void()>> &tasks)
+{
+    pool().run(tasks);
+}